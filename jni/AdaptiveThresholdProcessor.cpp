@@ -2,176 +2,459 @@
 #include "GLProgramManager.h"
 #include "GLResources.h"
 #include "ImageProcessorWorkflow.h"
+#include <algorithm>
 #include <cmath>
+#include <stdio.h>
 #include <stdlib.h>
 
 AdaptiveThresholdProcessor::AdaptiveThresholdProcessor()
-  : m_uTextureRow(0)
-  , m_uScreenGeometryRow(0)
-  , m_uKernelRow(0)
-  , m_programRow(0)
-  , m_uTextureColumn(0)
-  , m_uScreenGeometryColumn(0)
-  , m_uKernelColumn(0)
-  , m_programColumn(0)
+  : m_method(ADAPTIVE_THRESH_GAUSSIAN)
+  , m_reduction(1)
+  , m_margin(0)
   , m_maxValue(0)
+  , m_blockSize(GaussianBlurProcessor::s_block_size)
+  , m_delta(0)
+  , m_vPositionIndexThreshold(0)
   , m_uTextureOrigThreshold(0)
   , m_uTextureBlurThreshold(0)
   , m_uScreenGeometryThresholdg(0)
   , m_uMaxValueThreshold(0)
+  , m_uDeltaThreshold(0)
   , m_programThreshold(0)
+  , m_uTextureOrigThresholdPacked(0)
+  , m_uTextureBlurThresholdPacked(0)
+  , m_uScreenGeometryThresholdPacked(0)
+  , m_uMaxValueThresholdPacked(0)
+  , m_uDeltaThresholdPacked(0)
+  , m_programThresholdPacked(0)
+  , m_uTextureMean(0)
+  , m_uTableMean(0)
+  , m_uBlockSizeMean(0)
+  , m_uMaxValueMean(0)
+  , m_uDeltaMean(0)
+  , m_programMean(0)
+  , m_uTextureMeanPacked(0)
+  , m_uTableMeanPacked(0)
+  , m_uBlockSizeMeanPacked(0)
+  , m_uPixelWidthMeanPacked(0)
+  , m_uMaxValueMeanPacked(0)
+  , m_uDeltaMeanPacked(0)
+  , m_programMeanPacked(0)
+  , m_uTextureReduce(0)
+  , m_uTextureSizeReduce(0)
+  , m_uOriginReduce(0)
+  , m_programReduce(0)
+  , m_uTextureReducePacked(0)
+  , m_uTextureSizeReducePacked(0)
+  , m_uOriginReducePacked(0)
+  , m_uImageWidthReducePacked(0)
+  , m_programReducePacked(0)
+  , m_uMaxValuePyramid(0)
+  , m_uDeltaPyramid(0)
+  , m_uTextureSizePyramid(0)
+  , m_uTextureOrigPyramid(0)
+  , m_uTextureBlurPyramid(0)
+  , m_uBlurSizePyramid(0)
+  , m_uBlurScalePyramid(0)
+  , m_uBlurOffsetPyramid(0)
+  , m_programPyramid(0)
+  , m_uMaxValuePyramidPacked(0)
+  , m_uDeltaPyramidPacked(0)
+  , m_uTextureSizePyramidPacked(0)
+  , m_uTextureOrigPyramidPacked(0)
+  , m_uTextureBlurPyramidPacked(0)
+  , m_uBlurSizePyramidPacked(0)
+  , m_uBlurScalePyramidPacked(0)
+  , m_uBlurOffsetPyramidPacked(0)
+  , m_programPyramidPacked(0)
 {
 }
 
 bool
-AdaptiveThresholdProcessor::init(GLProgramManager* pm, int maxValue)
+AdaptiveThresholdProcessor::init(GLProgramManager* pm, int maxValue,
+                                 Method method, int blockSize, double delta,
+                                 double tolerance)
 {
+  if (blockSize < 1) {
+    GLIMPROC_LOGE("invalid block size %d.\n", blockSize);
+    return false;
+  }
   m_maxValue = maxValue;
-  initGaussianBlurKernel();
+  m_method = method;
+  m_blockSize = blockSize;
+  m_delta = static_cast<GLint>(std::ceil(delta));
+  // the mean method costs the same at any block size.
+  m_reduction = method == ADAPTIVE_THRESH_GAUSSIAN
+                  ? reductionFor(blockSize, tolerance)
+                  : 1;
+  if (m_reduction > 1) {
+    return initPyramid(pm);
+  }
+  bool ready = method == ADAPTIVE_THRESH_MEAN ? m_table.init(pm)
+                                              : m_blur.init(pm, blockSize);
+  if (!ready) {
+    return false;
+  }
   return initProgram(pm);
 }
 
-std::vector<GLfloat>
-AdaptiveThresholdProcessor::getGaussianKernel(int n)
+void
+AdaptiveThresholdProcessor::setBilinearTaps(bool enable)
 {
-  std::vector<GLfloat> kernel(n);
-  float* cf = const_cast<float*>(kernel.data());
-
-  double sigmaX = ((n - 1) * 0.5 - 1) * 0.3 + 0.8;
-  double scale2X = -0.5 / (sigmaX * sigmaX);
-  double sum = 0;
-
-  int i;
-  for (i = 0; i < n; i++) {
-    double x = i - (n - 1) * 0.5;
-    double t = std::exp(scale2X * x * x);
-    {
-      cf[i] = (float)t;
-      sum += cf[i];
+  m_blur.setBilinearTaps(enable);
+  m_reducedBlur.setBilinearTaps(enable);
+}
+
+double
+AdaptiveThresholdProcessor::reducedSigma(int blockSize, int reduction)
+{
+  double sigma = GaussianBlurProcessor::getGaussianSigma(blockSize);
+  // the box of reduction pixels adds its variance to that of the blur.
+  double variance = sigma * sigma - (reduction * reduction - 1) / 12.0;
+  return variance > 0.0 ? std::sqrt(variance) / reduction : 0.0;
+}
+
+int
+AdaptiveThresholdProcessor::reductionFor(int blockSize, double tolerance)
+{
+  double sigma = GaussianBlurProcessor::getGaussianSigma(blockSize);
+  // a gaussian blur of 8 bit pixels bends by at most 255 times
+  // 2 / sqrt(2 pi e) / sigma^2 per axis, bilinear interpolation between
+  // samples f apart is off by at most f^2 / 8 times the bends of both.
+  double bend = 255.0 * 0.4839 / (sigma * sigma);
+  int reduction = 1;
+  for (int f = 2; f <= 8; f *= 2) {
+    // a kernel sampled less than a pixel apart is no gaussian anymore.
+    if (f * f / 8.0 * 2.0 * bend > tolerance ||
+        reducedSigma(blockSize, f) < 1.0) {
+      break;
     }
+    reduction = f;
   }
+  return reduction;
+}
 
-  sum = 1. / sum;
-  for (i = 0; i < n; i++) {
-    cf[i] = (float)(cf[i] * sum);
+bool
+AdaptiveThresholdProcessor::initPyramid(GLProgramManager* pm)
+{
+  double sigma = reducedSigma(m_blockSize, m_reduction);
+  // the taps opencv gives an 8 bit image for sigma.
+  int blockSize = static_cast<int>(sigma * 6.0 + 1.5) | 1;
+  // the blur, the bilinear fetch and the partial block at the far border
+  // stay inside.
+  m_margin = blockSize / 2 + 2;
+  if (!m_reducedBlur.init(pm, blockSize, sigma)) {
+    return false;
   }
+  char defines[64], definesPacked[64];
+  snprintf(defines, sizeof(defines), "#define REDUCTION %d\n", m_reduction);
+  snprintf(definesPacked, sizeof(definesPacked),
+           "#define REDUCTION %d\n#define PACKED\n", m_reduction);
+  m_programReduce = pm->getProgram(GLProgramManager::ADAPTIVEREDUCE, defines);
+  m_programReducePacked =
+    pm->getProgram(GLProgramManager::ADAPTIVEREDUCE, definesPacked);
+  m_programPyramid = pm->getProgram(GLProgramManager::ADAPTIVEPYRAMID, "");
+  m_programPyramidPacked =
+    pm->getProgram(GLProgramManager::ADAPTIVEPYRAMID, "#define PACKED\n");
+  if (!m_programReduce || !m_programReducePacked || !m_programPyramid ||
+      !m_programPyramidPacked) {
+    return false;
+  }
+  GLint program = m_programReduce;
+  m_uTextureReduce = glGetUniformLocation(program, "u_texture");
+  m_uTextureSizeReduce = glGetUniformLocation(program, "u_textureSize");
+  m_uOriginReduce = glGetUniformLocation(program, "u_origin");
 
-  return kernel;
-}
+  program = m_programReducePacked;
+  m_uTextureReducePacked = glGetUniformLocation(program, "u_texture");
+  m_uTextureSizeReducePacked =
+    glGetUniformLocation(program, "u_textureSize");
+  m_uOriginReducePacked = glGetUniformLocation(program, "u_origin");
+  m_uImageWidthReducePacked = glGetUniformLocation(program, "u_imageWidth");
 
-void
-AdaptiveThresholdProcessor::initGaussianBlurKernel()
-{
-  m_kernel = std::move(getGaussianKernel(s_block_size));
+  program = m_programPyramid;
+  m_uMaxValuePyramid = glGetUniformLocation(program, "u_maxValue");
+  m_uDeltaPyramid = glGetUniformLocation(program, "u_delta");
+  m_uTextureSizePyramid = glGetUniformLocation(program, "u_textureSize");
+  m_uTextureOrigPyramid = glGetUniformLocation(program, "u_textureOrig");
+  m_uTextureBlurPyramid = glGetUniformLocation(program, "u_textureBlur");
+  m_uBlurSizePyramid = glGetUniformLocation(program, "u_blurSize");
+  m_uBlurScalePyramid = glGetUniformLocation(program, "u_blurScale");
+  m_uBlurOffsetPyramid = glGetUniformLocation(program, "u_blurOffset");
+
+  program = m_programPyramidPacked;
+  m_uMaxValuePyramidPacked = glGetUniformLocation(program, "u_maxValue");
+  m_uDeltaPyramidPacked = glGetUniformLocation(program, "u_delta");
+  m_uTextureSizePyramidPacked =
+    glGetUniformLocation(program, "u_textureSize");
+  m_uTextureOrigPyramidPacked =
+    glGetUniformLocation(program, "u_textureOrig");
+  m_uTextureBlurPyramidPacked =
+    glGetUniformLocation(program, "u_textureBlur");
+  m_uBlurSizePyramidPacked = glGetUniformLocation(program, "u_blurSize");
+  m_uBlurScalePyramidPacked = glGetUniformLocation(program, "u_blurScale");
+  m_uBlurOffsetPyramidPacked = glGetUniformLocation(program, "u_blurOffset");
+  return checkError("initPyramid");
 }
 
 bool
 AdaptiveThresholdProcessor::initProgram(GLProgramManager* pm)
 {
-  m_programRow = pm->getProgram(GLProgramManager::GAUSSIANROW);
-  m_programColumn = pm->getProgram(GLProgramManager::GAUSSIANCOLUMN);
-  GLint program = m_programRow;
-  m_uTextureRow = glGetUniformLocation(program, "u_texture");
-  m_uScreenGeometryRow = glGetUniformLocation(program, "u_screenGeometry");
-  m_uKernelRow = glGetUniformLocation(program, "u_kernel");
-  GLIMPROC_LOGI(
-    "m_uTextureRow: %d, m_uScreenGeometryRow: %d, m_uKernelRow: %d.\n",
-    m_uTextureRow, m_uScreenGeometryRow, m_uKernelRow);
-
-  program = m_programColumn;
-
-  m_uTextureColumn = glGetUniformLocation(program, "u_texture");
-  m_uScreenGeometryColumn = glGetUniformLocation(program, "u_screenGeometry");
-  m_uKernelColumn = glGetUniformLocation(program, "u_kernel");
-  GLIMPROC_LOGI(
-    "m_uTextureColumn: %d, m_uScreenGeometryColumn: %d, m_uKernelColumn: "
-    "%d.\n",
-    m_uTextureColumn, m_uScreenGeometryColumn, m_uKernelColumn);
+  if (m_method == ADAPTIVE_THRESH_MEAN) {
+    m_programMean = pm->getProgram(GLProgramManager::ADAPTIVEMEAN);
+    m_programMeanPacked =
+      pm->getProgram(GLProgramManager::ADAPTIVEMEANPACKED);
+    if (!m_programMean || !m_programMeanPacked) {
+      return false;
+    }
+    GLint program = m_programMean;
+    m_uTextureMean = glGetUniformLocation(program, "u_texture");
+    m_uTableMean = glGetUniformLocation(program, "u_table");
+    m_uBlockSizeMean = glGetUniformLocation(program, "u_blockSize");
+    m_uMaxValueMean = glGetUniformLocation(program, "u_maxValue");
+    m_uDeltaMean = glGetUniformLocation(program, "u_delta");
 
+    program = m_programMeanPacked;
+    m_uTextureMeanPacked = glGetUniformLocation(program, "u_texture");
+    m_uTableMeanPacked = glGetUniformLocation(program, "u_table");
+    m_uBlockSizeMeanPacked = glGetUniformLocation(program, "u_blockSize");
+    m_uPixelWidthMeanPacked = glGetUniformLocation(program, "u_pixelWidth");
+    m_uMaxValueMeanPacked = glGetUniformLocation(program, "u_maxValue");
+    m_uDeltaMeanPacked = glGetUniformLocation(program, "u_delta");
+    return checkError("initProgram");
+  }
   m_programThreshold = pm->getProgram(GLProgramManager::ADAPTIVETHRESHOLD);
-  program = m_programThreshold;
+  GLint program = m_programThreshold;
 
   m_uTextureOrigThreshold = glGetUniformLocation(program, "u_textureOrig");
   m_uTextureBlurThreshold = glGetUniformLocation(program, "u_textureBlur");
   m_uScreenGeometryThresholdg =
     glGetUniformLocation(program, "u_screenGeometry");
   m_uMaxValueThreshold = glGetUniformLocation(program, "u_maxValue");
+  m_uDeltaThreshold = glGetUniformLocation(program, "u_delta");
   GLIMPROC_LOGI("m_uTextureOrigThreshold: %d, m_uTextureBlurThreshold: %d, "
                 "m_uScreenGeometryThreshold: %d, m_uMaxValueThreshold: %d.\n",
                 m_uTextureOrigThreshold, m_uTextureBlurThreshold,
                 m_uScreenGeometryThresholdg, m_uMaxValueThreshold);
+
+  m_programThresholdPacked =
+    pm->getProgram(GLProgramManager::ADAPTIVETHRESHOLDPACKED);
+  program = m_programThresholdPacked;
+  m_uTextureOrigThresholdPacked =
+    glGetUniformLocation(program, "u_textureOrig");
+  m_uTextureBlurThresholdPacked =
+    glGetUniformLocation(program, "u_textureBlur");
+  m_uScreenGeometryThresholdPacked =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uMaxValueThresholdPacked = glGetUniformLocation(program, "u_maxValue");
+  m_uDeltaThresholdPacked = glGetUniformLocation(program, "u_delta");
   return checkError("initProgram");
 }
 
+ProcessorFootprint
+AdaptiveThresholdProcessor::footprint() const
+{
+  // the block around a pixel, the comparison reads one pixel of the blur.
+  GLint half = m_blockSize / 2;
+  GLint rest = m_blockSize - 1 - half;
+  if (m_reduction > 1) {
+    // the reduced pixels the background is interpolated from.
+    GLint reach = m_margin * m_reduction;
+    half = std::max(half, reach);
+    rest = std::max(rest, reach);
+  }
+  return ProcessorFootprint{ half, rest, rest, half };
+}
+
+// the summed-area table of the mean, padded by the block.
+ProcessorExtent
+AdaptiveThresholdProcessor::scratchExtent() const
+{
+  if (m_method == ADAPTIVE_THRESH_MEAN) {
+    return SummedAreaTable::extent(footprint());
+  }
+  return ProcessorExtent{ 0, 0 };
+}
+
 ProcessorOutput
 AdaptiveThresholdProcessor::process(const ProcessorInput& pin)
 {
+  if (m_method == ADAPTIVE_THRESH_MEAN) {
+    return processMean(pin);
+  }
+  if (m_reduction > 1) {
+    return processPyramid(pin);
+  }
   ImageProcessorWorkflow* wf = pin.wf;
+  ProcessorOutput blur = m_blur.process(pin);
   FBOScope fboscope(wf);
-  // zero for row blur, one for column blur
-  // zero additionally used as the final threshold output.
-  std::shared_ptr<GLTexture> tmpTexture[2] = {
-    wf->requestTextureForFramebuffer(), wf->requestTextureForFramebuffer()
-  };
-
-  // bind fbo and complete it.
-  wf->setColorAttachmentForFramebuffer(tmpTexture[0]->id());
-
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d, %x.\n", __LINE__,
-                  wf->checkFramebuffer());
-    exit(1);
-  }
+  std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
   GLint imageGeometry[2] = { pin.width, pin.height };
-  glUseProgram(m_programRow);
+
   // setup uniforms
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, pin.color->id());
-  glUniform1i(m_uTextureRow, 0);
+  glActiveTexture(GL_TEXTURE0 + 1);
+  glBindTexture(GL_TEXTURE_2D, blur.color->id());
+  GLfloat maxValue = static_cast<float>(m_maxValue) / 255.0f;
+  if (pin.packed) {
+    glUseProgram(m_programThresholdPacked);
+    glUniform1i(m_uTextureOrigThresholdPacked, 0);
+    glUniform1i(m_uTextureBlurThresholdPacked, 1);
+    glUniform2iv(m_uScreenGeometryThresholdPacked, 1, imageGeometry);
+    glUniform1f(m_uMaxValueThresholdPacked, maxValue);
+    glUniform1f(m_uDeltaThresholdPacked, static_cast<GLfloat>(m_delta));
+  } else {
+    glUseProgram(m_programThreshold);
+    glUniform1i(m_uTextureOrigThreshold, 0);
+    glUniform1i(m_uTextureBlurThreshold, 1);
 
-  glUniform2iv(m_uScreenGeometryRow, 1, imageGeometry);
-  // setup kernel and block size
+    glUniform2iv(m_uScreenGeometryThresholdg, 1, imageGeometry);
+    glUniform1f(m_uMaxValueThreshold, maxValue);
+    glUniform1f(m_uDeltaThreshold, static_cast<GLfloat>(m_delta));
+  }
 
-  glUniform4fv(m_uKernelRow, s_block_size / 4, m_kernel.data());
+  wf->bindRenderTarget(target.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  // bind fbo and complete it.
-  wf->setColorAttachmentForFramebuffer(tmpTexture[1]->id());
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d.\n", __LINE__);
-    exit(1);
+  checkError("image process");
+  return ProcessorOutput{ target };
+}
+
+ProcessorOutput
+AdaptiveThresholdProcessor::processMean(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  ProcessorFootprint block = footprint();
+  std::shared_ptr<GLTexture> table = m_table.build(pin, block);
+  if (!table) {
+    // logged by build().
+    return ProcessorOutput{ nullptr };
   }
+  FBOScope fboscope(wf);
+  std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+  GLint blockSize[2] = { block.left + 1 + block.right,
+                         block.bottom + 1 + block.top };
 
-  glUseProgram(m_programColumn);
-  // setup uniforms
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, tmpTexture[0]->id());
-  glUniform1i(m_uTextureColumn, 0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  glActiveTexture(GL_TEXTURE0 + 1);
+  glBindTexture(GL_TEXTURE_2D, table->id());
+  GLfloat maxValue = static_cast<float>(m_maxValue) / 255.0f;
+  if (pin.packed) {
+    glUseProgram(m_programMeanPacked);
+    glUniform1i(m_uTextureMeanPacked, 0);
+    glUniform1i(m_uTableMeanPacked, 1);
+    glUniform2iv(m_uBlockSizeMeanPacked, 1, blockSize);
+    glUniform1i(m_uPixelWidthMeanPacked, pin.pixelWidth);
+    glUniform1f(m_uMaxValueMeanPacked, maxValue);
+    glUniform1i(m_uDeltaMeanPacked, m_delta);
+  } else {
+    glUseProgram(m_programMean);
+    glUniform1i(m_uTextureMean, 0);
+    glUniform1i(m_uTableMean, 1);
+    glUniform2iv(m_uBlockSizeMean, 1, blockSize);
+    glUniform1f(m_uMaxValueMean, maxValue);
+    glUniform1i(m_uDeltaMean, m_delta);
+  }
 
-  glUniform2iv(m_uScreenGeometryColumn, 1, imageGeometry);
-  // setup kernel and block size
+  wf->bindRenderTarget(target.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  checkError("image process");
+  return ProcessorOutput{ target };
+}
+
+ProcessorOutput
+AdaptiveThresholdProcessor::processPyramid(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLint pixelWidth = pin.packed ? pin.pixelWidth : pin.width;
+  GLint width = (pixelWidth + m_reduction - 1) / m_reduction + 2 * m_margin;
+  GLint height = (pin.height + m_reduction - 1) / m_reduction + 2 * m_margin;
+  GLfloat textureSize[2] = { static_cast<GLfloat>(pin.width),
+                             static_cast<GLfloat>(pin.height) };
+  GLfloat blurSize[2] = { static_cast<GLfloat>(width),
+                          static_cast<GLfloat>(height) };
+  GLfloat origin = static_cast<GLfloat>(-m_margin * m_reduction);
+  std::shared_ptr<GLTexture> reduced =
+    wf->requestTextureForFramebuffer(width, height, GL_RGBA);
 
-  glUniform4fv(m_uKernelColumn, s_block_size / 4, m_kernel.data());
+  // the reduced passes cover the whole image, whatever the scissor.
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  glViewport(0, 0, width, height);
+  wf->bindRenderTarget(reduced.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  if (pin.packed) {
+    glUseProgram(m_programReducePacked);
+    glUniform1i(m_uTextureReducePacked, 0);
+    glUniform2fv(m_uTextureSizeReducePacked, 1, textureSize);
+    glUniform1f(m_uOriginReducePacked, origin);
+    glUniform1f(m_uImageWidthReducePacked,
+                static_cast<GLfloat>(pin.pixelWidth));
+  } else {
+    glUseProgram(m_programReduce);
+    glUniform1i(m_uTextureReduce, 0);
+    glUniform2fv(m_uTextureSizeReduce, 1, textureSize);
+    glUniform1f(m_uOriginReduce, origin);
+    setTextureFilter(pin.color->id(), GL_LINEAR);
+  }
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  // render to screen
+  if (!pin.packed) {
+    setTextureFilter(pin.color->id(), GL_NEAREST);
+  }
+  ProcessorInput reducedInput = { width, height, reduced, wf };
+  ProcessorOutput blur = m_reducedBlur.process(reducedInput);
+  reduced.reset();
+  glViewport(0, 0, pin.width, pin.height);
+  if (scissor) {
+    glEnable(GL_SCISSOR_TEST);
+  }
 
-  glUseProgram(m_programThreshold);
-  // setup uniforms
+  std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+  // the kernel of an even block size is centered half a pixel left of
+  // and above the pixel, as in GaussianBlurProcessor.
+  GLfloat scale = 1.0f / m_reduction;
+  GLfloat shift = static_cast<GLfloat>((m_blockSize - 1) / 2.0 -
+                                       m_blockSize / 2) /
+                  m_reduction;
+  GLfloat blurOffset[2] = { m_margin + shift, m_margin - shift };
+  GLfloat maxValue = static_cast<float>(m_maxValue) / 255.0f;
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, pin.color->id());
-  glUniform1i(m_uTextureOrigThreshold, 0);
   glActiveTexture(GL_TEXTURE0 + 1);
-  glBindTexture(GL_TEXTURE_2D, tmpTexture[1]->id());
-  glUniform1i(m_uTextureBlurThreshold, 1);
-
-  glUniform2iv(m_uScreenGeometryThresholdg, 1, imageGeometry);
-  glUniform1f(m_uMaxValueThreshold, static_cast<float>(m_maxValue) / 255.0f);
-
-  wf->setColorAttachmentForFramebuffer(tmpTexture[0]->id());
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d.\n", __LINE__);
-    exit(1);
+  setTextureFilter(blur.color->id(), GL_LINEAR);
+  if (pin.packed) {
+    glUseProgram(m_programPyramidPacked);
+    glUniform1f(m_uMaxValuePyramidPacked, maxValue);
+    glUniform1f(m_uDeltaPyramidPacked, static_cast<GLfloat>(m_delta));
+    glUniform2fv(m_uTextureSizePyramidPacked, 1, textureSize);
+    glUniform1i(m_uTextureOrigPyramidPacked, 0);
+    glUniform1i(m_uTextureBlurPyramidPacked, 1);
+    glUniform2fv(m_uBlurSizePyramidPacked, 1, blurSize);
+    glUniform1f(m_uBlurScalePyramidPacked, scale);
+    glUniform2fv(m_uBlurOffsetPyramidPacked, 1, blurOffset);
+  } else {
+    glUseProgram(m_programPyramid);
+    glUniform1f(m_uMaxValuePyramid, maxValue);
+    glUniform1f(m_uDeltaPyramid, static_cast<GLfloat>(m_delta));
+    glUniform2fv(m_uTextureSizePyramid, 1, textureSize);
+    glUniform1i(m_uTextureOrigPyramid, 0);
+    glUniform1i(m_uTextureBlurPyramid, 1);
+    glUniform2fv(m_uBlurSizePyramid, 1, blurSize);
+    glUniform1f(m_uBlurScalePyramid, scale);
+    glUniform2fv(m_uBlurOffsetPyramid, 1, blurOffset);
   }
+
+  wf->bindRenderTarget(target.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  setTextureFilter(blur.color->id(), GL_NEAREST);
+  glActiveTexture(GL_TEXTURE0);
   checkError("image process");
-  return ProcessorOutput{ tmpTexture[0] };
+  return ProcessorOutput{ target };
 }
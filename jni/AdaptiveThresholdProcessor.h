@@ -1,43 +1,133 @@
 #ifndef ADAPTIVETHRESHOLDPROCESSOR_H
 #define ADAPTIVETHRESHOLDPROCESSOR_H
+#include "GaussianBlurProcessor.h"
 #include "IImageProcessor.h"
-#include <vector>
+#include "SummedAreaTable.h"
 
 class GLProgramManager;
 
 class AdaptiveThresholdProcessor final : public IImageProcessor
 {
 public:
+  // the local mean a pixel is compared with, named as in opencv.
+  enum Method
+  {
+    // the plain mean of the block, from a summed-area table. its cost
+    // does not grow with the block size. needs gles3.
+    ADAPTIVE_THRESH_MEAN,
+    // the gaussian weighted mean.
+    ADAPTIVE_THRESH_GAUSSIAN,
+  };
   AdaptiveThresholdProcessor();
   ~AdaptiveThresholdProcessor() = default;
-  bool init(GLProgramManager* pm, int maxValue);
+  // as cv::adaptiveThreshold with THRESH_BINARY: maxValue where a pixel
+  // is above the mean of the blockSize x blockSize pixels around it
+  // minus delta, else zero. a positive tolerance lets the gaussian mean
+  // be off by up to that many levels, it is then blurred at a resolution
+  // reduced as far as that allows, see reductionFor.
+  bool init(GLProgramManager* pm, int maxValue,
+            Method method = ADAPTIVE_THRESH_GAUSSIAN,
+            int blockSize = GaussianBlurProcessor::s_block_size,
+            double delta = 0.0, double tolerance = 0.0);
   ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  ProcessorExtent scratchExtent() const override;
+  bool supportsPackedLuma() const override { return true; }
+  // see GaussianBlurProcessor::setBilinearTaps.
+  void setBilinearTaps(bool enable);
+  // the largest of 2, 4 and 8 by which the gaussian mean of blockSize
+  // pixels can be reduced keeping within tolerance of the full resolution
+  // blur, 1 if none can.
+  static int reductionFor(int blockSize, double tolerance);
+  // the sigma of the blur at reduced resolution that, after the box
+  // filter of the reduction, matches the sigma of blockSize.
+  static double reducedSigma(int blockSize, int reduction);
 
 private:
-  std::vector<GLfloat> m_kernel;
+  ProcessorOutput processMean(const ProcessorInput& pin);
+  // box filtered down by m_reduction, blurred and compared with the
+  // background sampled back up bilinearly.
+  ProcessorOutput processPyramid(const ProcessorInput& pin);
 
-  GLint m_uTextureRow;
-  GLint m_uScreenGeometryRow;
-  GLint m_uKernelRow;
-  GLint m_programRow;
-
-  GLint m_uTextureColumn;
-  GLint m_uScreenGeometryColumn;
-  GLint m_uKernelColumn;
-  GLint m_programColumn;
+  Method m_method;
+  // the gaussian weighted local mean.
+  GaussianBlurProcessor m_blur;
+  SummedAreaTable m_table;
+  // the pyramid mode, m_reduction is 1 without it. the reduced image
+  // extends m_margin reduced pixels past the image on every side, the
+  // blur never reaches its mirrored borders.
+  GLint m_reduction;
+  GLint m_margin;
+  GaussianBlurProcessor m_reducedBlur;
 
   GLint m_maxValue;
+  GLint m_blockSize;
+  // delta rounded up, the means and pixels are whole 8 bit values.
+  GLint m_delta;
 
   GLint m_vPositionIndexThreshold;
   GLint m_uTextureOrigThreshold;
   GLint m_uTextureBlurThreshold;
   GLint m_uScreenGeometryThresholdg;
   GLint m_uMaxValueThreshold;
+  GLint m_uDeltaThreshold;
   GLint m_programThreshold;
 
-  static const GLint s_block_size = 92;
-  void initGaussianBlurKernel();
+  // the comparison on packed luma.
+  GLint m_uTextureOrigThresholdPacked;
+  GLint m_uTextureBlurThresholdPacked;
+  GLint m_uScreenGeometryThresholdPacked;
+  GLint m_uMaxValueThresholdPacked;
+  GLint m_uDeltaThresholdPacked;
+  GLint m_programThresholdPacked;
+
+  GLint m_uTextureMean;
+  GLint m_uTableMean;
+  GLint m_uBlockSizeMean;
+  GLint m_uMaxValueMean;
+  GLint m_uDeltaMean;
+  GLint m_programMean;
+
+  GLint m_uTextureMeanPacked;
+  GLint m_uTableMeanPacked;
+  GLint m_uBlockSizeMeanPacked;
+  GLint m_uPixelWidthMeanPacked;
+  GLint m_uMaxValueMeanPacked;
+  GLint m_uDeltaMeanPacked;
+  GLint m_programMeanPacked;
+
+  GLint m_uTextureReduce;
+  GLint m_uTextureSizeReduce;
+  GLint m_uOriginReduce;
+  GLint m_programReduce;
+
+  GLint m_uTextureReducePacked;
+  GLint m_uTextureSizeReducePacked;
+  GLint m_uOriginReducePacked;
+  GLint m_uImageWidthReducePacked;
+  GLint m_programReducePacked;
+
+  GLint m_uMaxValuePyramid;
+  GLint m_uDeltaPyramid;
+  GLint m_uTextureSizePyramid;
+  GLint m_uTextureOrigPyramid;
+  GLint m_uTextureBlurPyramid;
+  GLint m_uBlurSizePyramid;
+  GLint m_uBlurScalePyramid;
+  GLint m_uBlurOffsetPyramid;
+  GLint m_programPyramid;
+
+  GLint m_uMaxValuePyramidPacked;
+  GLint m_uDeltaPyramidPacked;
+  GLint m_uTextureSizePyramidPacked;
+  GLint m_uTextureOrigPyramidPacked;
+  GLint m_uTextureBlurPyramidPacked;
+  GLint m_uBlurSizePyramidPacked;
+  GLint m_uBlurScalePyramidPacked;
+  GLint m_uBlurOffsetPyramidPacked;
+  GLint m_programPyramidPacked;
+
   bool initProgram(GLProgramManager* pm);
-  static std::vector<GLfloat> getGaussianKernel(int n);
+  bool initPyramid(GLProgramManager* pm);
 };
 #endif /* ADAPTIVETHRESHOLDPROCESSOR_H */
@@ -23,12 +23,34 @@ LOCAL_MODULE    := glthreshold
 LOCAL_SRC_FILES := main.cpp \
 log.cpp \
 GLContextManager.cpp \
+GLWorkerPool.cpp \
 AdaptiveThresholdProcessor.cpp \
+SauvolaThresholdProcessor.cpp \
 ThresholdProcessor.cpp \
+OtsuThresholdProcessor.cpp \
+ConnectedComponentsProcessor.cpp \
 DilateNonZeroProcessor.cpp \
 ErodeNonZeroProcessor.cpp \
+MorphologyPlan.cpp \
+MorphologyScan.cpp \
+MorphologyDoubling.cpp \
+MorphologyMask.cpp \
+StructuringElement.cpp \
+GaussianBlurProcessor.cpp \
+CompareProcessor.cpp \
+SubtractProcessor.cpp \
 ImageProcessorWorkflow.cpp \
+InputTexture.cpp \
+ProcessorGraph.cpp \
+AsyncReadback.cpp \
+PassFusionPlanner.cpp \
+PipelineOptimizer.cpp \
+FusedPassProcessor.cpp \
+PackProcessor.cpp \
 GLResources.cpp \
+GLTexturePool.cpp \
+FrameTexturePlan.cpp \
+SummedAreaTable.cpp \
 GLCommon.cpp \
 GLProgramManager.cpp \
 glsl.glsl.c \
@@ -60,5 +82,5 @@ $(GLSL_BINDING): $(LOCAL_PATH)/glsl.glsl jni/updateglsl.py
 	python jni/updateglsl.py $<
 
 
-LOCAL_LDLIBS = -lz -lGLESv2 -lEGL -llog
+LOCAL_LDLIBS = -lz -lGLESv2 -lGLESv3 -lEGL -llog
 include $(BUILD_EXECUTABLE)
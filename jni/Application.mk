@@ -1,2 +1,3 @@
 APP_ABI := armeabi-v7a
 APP_STL := gnustl_static
+APP_PLATFORM := android-18
@@ -0,0 +1,219 @@
+#include "AsyncReadback.h"
+#include <GLES3/gl3.h>
+#include <string.h>
+
+struct ReadbackSlot
+{
+  ReadbackSlot();
+  ~ReadbackSlot();
+  GLuint pbo;
+  GLsync fence;
+  size_t size;
+  // the handle of the frame in the slot, null once it is gone.
+  ImageOutputFuture* holder;
+};
+
+ReadbackSlot::ReadbackSlot()
+  : pbo(0)
+  , fence(nullptr)
+  , size(0)
+  , holder(nullptr)
+{
+  CHECK_CONTEXT_NOT_NULL();
+  glGenBuffers(1, &pbo);
+}
+
+ReadbackSlot::~ReadbackSlot()
+{
+  CHECK_CONTEXT_NOT_NULL();
+  if (fence) {
+    glDeleteSync(fence);
+  }
+  glDeleteBuffers(1, &pbo);
+}
+
+ImageOutputFuture::ImageOutputFuture()
+  : m_mapped(nullptr)
+  , m_stride(0)
+{
+}
+
+ImageOutputFuture::ImageOutputFuture(std::unique_ptr<uint8_t[]> bytes,
+                                     GLint stride)
+  : m_bytes(std::move(bytes))
+  , m_mapped(nullptr)
+  , m_stride(stride)
+{
+}
+
+ImageOutputFuture::ImageOutputFuture(ImageOutputFuture&& other)
+  : m_slot(std::move(other.m_slot))
+  , m_bytes(std::move(other.m_bytes))
+  , m_mapped(other.m_mapped)
+  , m_stride(other.m_stride)
+{
+  other.m_mapped = nullptr;
+  if (m_slot) {
+    m_slot->holder = this;
+  }
+}
+
+ImageOutputFuture&
+ImageOutputFuture::operator=(ImageOutputFuture&& other)
+{
+  if (this != &other) {
+    release();
+    m_slot = std::move(other.m_slot);
+    m_bytes = std::move(other.m_bytes);
+    m_mapped = other.m_mapped;
+    m_stride = other.m_stride;
+    other.m_mapped = nullptr;
+    if (m_slot) {
+      m_slot->holder = this;
+    }
+  }
+  return *this;
+}
+
+ImageOutputFuture::~ImageOutputFuture()
+{
+  release();
+}
+
+void
+ImageOutputFuture::release()
+{
+  unmap();
+  if (m_slot && m_slot->holder == this) {
+    m_slot->holder = nullptr;
+  }
+  m_slot.reset();
+}
+
+bool
+ImageOutputFuture::detach()
+{
+  const uint8_t* mapped = map();
+  if (!mapped) {
+    return false;
+  }
+  m_bytes.reset(new uint8_t[m_slot->size]);
+  memcpy(m_bytes.get(), mapped, m_slot->size);
+  release();
+  return true;
+}
+
+bool
+ImageOutputFuture::isReady()
+{
+  if (!m_slot) {
+    return true;
+  }
+  GLenum status = glClientWaitSync(m_slot->fence, 0, 0);
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+const uint8_t*
+ImageOutputFuture::map()
+{
+  if (!m_slot) {
+    return m_bytes.get();
+  }
+  if (m_mapped) {
+    return m_mapped;
+  }
+  // one second per wait, the flush bit only matters for the first one.
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  for (;;) {
+    GLenum status = glClientWaitSync(m_slot->fence, flags, 1000000000);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      break;
+    }
+    if (status == GL_WAIT_FAILED) {
+      GLIMPROC_LOGE("fails to wait for readback fence.\n");
+      return nullptr;
+    }
+    flags = 0;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slot->pbo);
+  m_mapped = static_cast<const uint8_t*>(
+    glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_slot->size, GL_MAP_READ_BIT));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return m_mapped;
+}
+
+void
+ImageOutputFuture::unmap()
+{
+  if (!m_slot || !m_mapped) {
+    return;
+  }
+  CHECK_CONTEXT_NOT_NULL();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slot->pbo);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  m_mapped = nullptr;
+}
+
+ReadbackRing::ReadbackRing(size_t count)
+  : m_next(0)
+{
+  for (size_t i = 0; i < count; ++i) {
+    m_slots.push_back(std::make_shared<ReadbackSlot>());
+  }
+}
+
+std::shared_ptr<ReadbackSlot>
+ReadbackRing::acquireSlot()
+{
+  for (size_t i = 0; i < m_slots.size(); ++i) {
+    size_t index = (m_next + i) % m_slots.size();
+    if (!m_slots[index]->holder) {
+      m_next = (index + 1) % m_slots.size();
+      return m_slots[index];
+    }
+  }
+  // every slot is held, the oldest frame not mapped by its handle moves to
+  // host memory once the GPU is done with it. m_next is the oldest slot.
+  for (size_t i = 0; i < m_slots.size(); ++i) {
+    size_t index = (m_next + i) % m_slots.size();
+    ImageOutputFuture* holder = m_slots[index]->holder;
+    if (!holder->m_mapped && holder->detach()) {
+      m_next = (index + 1) % m_slots.size();
+      return m_slots[index];
+    }
+  }
+  return nullptr;
+}
+
+ImageOutputFuture
+ReadbackRing::readPixels(GLint width, GLint height)
+{
+  std::shared_ptr<ReadbackSlot> slot = acquireSlot();
+  size_t size = static_cast<size_t>(width) * height * 4;
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  if (!slot) {
+    GLIMPROC_LOGE("every readback buffer is mapped, reading synchronously.\n");
+    std::unique_ptr<uint8_t[]> bytes(new uint8_t[size]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, bytes.get());
+    return ImageOutputFuture(std::move(bytes), width * 4);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+  if (slot->size != size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    slot->size = size;
+  }
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (slot->fence) {
+    glDeleteSync(slot->fence);
+  }
+  slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // get the readback going while the caller prepares the next frame.
+  glFlush();
+  ImageOutputFuture future;
+  future.m_slot = slot;
+  future.m_stride = width * 4;
+  slot->holder = &future;
+  return future;
+}
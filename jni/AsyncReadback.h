@@ -0,0 +1,65 @@
+#ifndef ASYNCREADBACK_H
+#define ASYNCREADBACK_H
+#include "GLCommon.h"
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct ReadbackSlot;
+
+// Handle to the pixels of one processed frame. On a GLES3 context
+// they are read into a pixel buffer object guarded by a fence and can be
+// mapped once the GPU has finished the frame; otherwise they already sit
+// in host memory, as they do once the ring needed the buffer back. Must be
+// used on the thread owning the context.
+class ImageOutputFuture
+{
+public:
+  ImageOutputFuture();
+  ImageOutputFuture(std::unique_ptr<uint8_t[]> bytes, GLint stride);
+  ImageOutputFuture(ImageOutputFuture&& other);
+  ImageOutputFuture& operator=(ImageOutputFuture&& other);
+  ImageOutputFuture(const ImageOutputFuture&) = delete;
+  ImageOutputFuture& operator=(const ImageOutputFuture&) = delete;
+  ~ImageOutputFuture();
+  bool isReady();
+  // blocks until the pixels have arrived. the data stays valid until
+  // unmap() or destruction of the handle.
+  const uint8_t* map();
+  void unmap();
+  // bytes between the starts of two rows.
+  inline GLint stride() const { return m_stride; }
+
+private:
+  friend class ReadbackRing;
+  // unmaps and lets the ring reuse the slot.
+  void release();
+  // copies the pixels to host memory once they have arrived and releases
+  // the slot.
+  bool detach();
+  std::shared_ptr<ReadbackSlot> m_slot;
+  std::unique_ptr<uint8_t[]> m_bytes;
+  const uint8_t* m_mapped;
+  GLint m_stride;
+};
+
+// A fixed number of pixel buffer objects that frames are read back into
+// in turn. A slot is reused once the handle of its previous frame is gone.
+// When every slot is still held, the oldest frame whose handle is not
+// mapped is waited for and copied to host memory, and when all of them
+// are mapped the frame is read back synchronously.
+class ReadbackRing final
+{
+public:
+  explicit ReadbackRing(size_t count);
+  ~ReadbackRing() = default;
+  // reads the color attachment of the bound framebuffer.
+  ImageOutputFuture readPixels(GLint width, GLint height);
+
+private:
+  std::shared_ptr<ReadbackSlot> acquireSlot();
+  std::vector<std::shared_ptr<ReadbackSlot>> m_slots;
+  size_t m_next;
+};
+#endif /* ASYNCREADBACK_H */
@@ -0,0 +1,94 @@
+#include "CompareProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdlib.h>
+
+CompareProcessor::CompareProcessor()
+  : m_uTextureOrig(0)
+  , m_uTextureBlur(0)
+  , m_uScreenGeometry(0)
+  , m_uMaxValue(0)
+  , m_uDelta(0)
+  , m_program(0)
+  , m_uTextureOrigPacked(0)
+  , m_uTextureBlurPacked(0)
+  , m_uScreenGeometryPacked(0)
+  , m_uMaxValuePacked(0)
+  , m_uDeltaPacked(0)
+  , m_programPacked(0)
+  , m_maxValue(0)
+{
+}
+
+bool
+CompareProcessor::init(GLProgramManager* pm, int maxValue)
+{
+  m_maxValue = maxValue;
+  m_program = pm->getProgram(GLProgramManager::ADAPTIVETHRESHOLD);
+  m_programPacked = pm->getProgram(GLProgramManager::ADAPTIVETHRESHOLDPACKED);
+  if (!m_program || !m_programPacked) {
+    return false;
+  }
+  GLint program = m_program;
+  m_uTextureOrig = glGetUniformLocation(program, "u_textureOrig");
+  m_uTextureBlur = glGetUniformLocation(program, "u_textureBlur");
+  m_uScreenGeometry = glGetUniformLocation(program, "u_screenGeometry");
+  m_uMaxValue = glGetUniformLocation(program, "u_maxValue");
+  m_uDelta = glGetUniformLocation(program, "u_delta");
+
+  program = m_programPacked;
+  m_uTextureOrigPacked = glGetUniformLocation(program, "u_textureOrig");
+  m_uTextureBlurPacked = glGetUniformLocation(program, "u_textureBlur");
+  m_uScreenGeometryPacked = glGetUniformLocation(program, "u_screenGeometry");
+  m_uMaxValuePacked = glGetUniformLocation(program, "u_maxValue");
+  m_uDeltaPacked = glGetUniformLocation(program, "u_delta");
+  return true;
+}
+
+ProcessorOutput
+CompareProcessor::process(const ProcessorInput& pin)
+{
+  if (pin.inputs.size() != 2) {
+    GLIMPROC_LOGE("CompareProcessor needs two inputs, got %zu.\n",
+                  pin.inputs.size());
+    exit(1);
+  }
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  std::shared_ptr<GLTexture> tmpTexture[1] = {
+    wf->requestTextureForFramebuffer()
+  };
+
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
+  GLfloat maxValue = static_cast<GLfloat>(m_maxValue) / 255.0f;
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.inputs[0]->id());
+  glActiveTexture(GL_TEXTURE0 + 1);
+  glBindTexture(GL_TEXTURE_2D, pin.inputs[1]->id());
+  if (pin.packed) {
+    glUseProgram(m_programPacked);
+    glUniform1i(m_uTextureOrigPacked, 0);
+    glUniform1i(m_uTextureBlurPacked, 1);
+    glUniform2iv(m_uScreenGeometryPacked, 1, imageGeometry);
+    glUniform1f(m_uMaxValuePacked, maxValue);
+    // the program is shared with AdaptiveThresholdProcessor, which may
+    // have left a delta in it.
+    glUniform1f(m_uDeltaPacked, 0.0f);
+  } else {
+    glUseProgram(m_program);
+    glUniform1i(m_uTextureOrig, 0);
+    glUniform1i(m_uTextureBlur, 1);
+    glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
+    glUniform1f(m_uMaxValue, maxValue);
+    // likewise shared.
+    glUniform1f(m_uDelta, 0.0f);
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+  return ProcessorOutput{ tmpTexture[0] };
+}
@@ -0,0 +1,34 @@
+#ifndef COMPAREPROCESSOR_H
+#define COMPAREPROCESSOR_H
+#include "IImageProcessor.h"
+
+class GLProgramManager;
+
+// Graph node with two inputs: maxValue where the first input is above the
+// second one, else zero. With a blurred copy of the input as the second
+// input this is the comparison of AdaptiveThresholdProcessor.
+class CompareProcessor final : public IImageProcessor
+{
+public:
+  CompareProcessor();
+  ~CompareProcessor() = default;
+  bool init(GLProgramManager* pm, int maxValue);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  bool supportsPackedLuma() const override { return true; }
+
+private:
+  GLint m_uTextureOrig;
+  GLint m_uTextureBlur;
+  GLint m_uScreenGeometry;
+  GLint m_uMaxValue;
+  GLint m_uDelta;
+  GLint m_program;
+  GLint m_uTextureOrigPacked;
+  GLint m_uTextureBlurPacked;
+  GLint m_uScreenGeometryPacked;
+  GLint m_uMaxValuePacked;
+  GLint m_uDeltaPacked;
+  GLint m_programPacked;
+  int m_maxValue;
+};
+#endif /* COMPAREPROCESSOR_H */
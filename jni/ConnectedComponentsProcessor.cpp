@@ -0,0 +1,591 @@
+#include "ConnectedComponentsProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <stdlib.h>
+
+// propagation passes between two reads of the occlusion query, each read
+// waits for the GPU.
+static const int s_passesPerCheck = 4;
+// entries per row of the list of runs, a power of two.
+static const GLint s_listWidth = 1024;
+// components per row of the table read back.
+static const GLint s_tableColumns = 512;
+
+// an entry of a summed-area table, which waits for the GPU.
+static GLint
+readEntry(ImageProcessorWorkflow* wf, GLTexture* table, GLint x, GLint y)
+{
+  GLuint entry[4];
+  wf->bindRenderTarget(table);
+  glReadPixels(x, y, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, entry);
+  return static_cast<GLint>(entry[0]);
+}
+
+ConnectedComponentsProcessor::ConnectedComponentsProcessor()
+  : m_valid(false)
+  , m_maxTextureSize(0)
+  , m_framebuffer(0)
+  , m_query(0)
+  , m_hooksWidth(0)
+  , m_hooksHeight(0)
+
+  , m_uTextureStarts(0)
+  , m_programStarts(0)
+
+  , m_uTextureStartsPacked(0)
+  , m_programStartsPacked(0)
+
+  , m_uTableRuns(0)
+  , m_uSizeRuns(0)
+  , m_uListWidthRuns(0)
+  , m_uCountRuns(0)
+  , m_uStartsRuns(0)
+  , m_programRuns(0)
+
+  , m_uRunsPropagate(0)
+  , m_uTablePropagate(0)
+  , m_uImageSizePropagate(0)
+  , m_uListWidthPropagate(0)
+  , m_uCountPropagate(0)
+  , m_uHooksPropagate(0)
+  , m_programPropagate(0)
+
+  , m_uRunsHook(0)
+  , m_uTableHook(0)
+  , m_uImageSizeHook(0)
+  , m_uListSizeHook(0)
+  , m_programHook(0)
+
+  , m_uRunsChanged(0)
+  , m_uPreviousChanged(0)
+  , m_programChanged(0)
+
+  , m_uRunsSort(0)
+  , m_uListWidthSort(0)
+  , m_uBlockSort(0)
+  , m_uDistanceSort(0)
+  , m_programSort(0)
+
+  , m_uRunsStats(0)
+  , m_uListWidthStats(0)
+  , m_programStats(0)
+
+  , m_uRunsReduce(0)
+  , m_uSumsReduce(0)
+  , m_uExtentsReduce(0)
+  , m_uListWidthReduce(0)
+  , m_uCountReduce(0)
+  , m_uStepReduce(0)
+  , m_programReduce(0)
+
+  , m_uRunsHeads(0)
+  , m_uListWidthHeads(0)
+  , m_uCountHeads(0)
+  , m_programHeads(0)
+
+  , m_uTableTable(0)
+  , m_uSizeTable(0)
+  , m_uListWidthTable(0)
+  , m_uCountTable(0)
+  , m_uRunsTable(0)
+  , m_uSumsTable(0)
+  , m_uExtentsTable(0)
+  , m_uColumnsTable(0)
+  , m_programTable(0)
+{
+}
+
+ConnectedComponentsProcessor::~ConnectedComponentsProcessor()
+{
+  if (m_framebuffer) {
+    CHECK_CONTEXT_NOT_NULL();
+    glDeleteFramebuffers(1, &m_framebuffer);
+  }
+  if (m_query) {
+    CHECK_CONTEXT_NOT_NULL();
+    glDeleteQueries(1, &m_query);
+  }
+}
+
+bool
+ConnectedComponentsProcessor::init(GLProgramManager* pm, int connectivity)
+{
+  if (connectivity != 4 && connectivity != 8) {
+    GLIMPROC_LOGE("invalid connectivity %d.\n", connectivity);
+    return false;
+  }
+  if (!isGLES3Context()) {
+    GLIMPROC_LOGE("connected components need a gles3 context.\n");
+    return false;
+  }
+  if (!m_ranks.init(pm)) {
+    return false;
+  }
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+  m_programStarts = pm->getProgram(GLProgramManager::CONNECTEDSTARTS, "");
+  m_programStartsPacked =
+    pm->getProgram(GLProgramManager::CONNECTEDSTARTS, "#define PACKED\n");
+  m_programRuns = pm->getProgram(GLProgramManager::CONNECTEDGATHER, "");
+  const char* reach = connectivity == 8 ? "#define EIGHT\n" : "";
+  m_programPropagate =
+    pm->getProgram(GLProgramManager::CONNECTEDPROPAGATE, reach);
+  m_programHook = pm->getProgram(GLProgramManager::CONNECTEDHOOK, reach);
+  m_programChanged = pm->getProgram(GLProgramManager::CONNECTEDCHANGED);
+  m_programSort = pm->getProgram(GLProgramManager::CONNECTEDSORT);
+  m_programStats = pm->getProgram(GLProgramManager::CONNECTEDSTATS);
+  m_programReduce = pm->getProgram(GLProgramManager::CONNECTEDREDUCE);
+  m_programHeads = pm->getProgram(GLProgramManager::CONNECTEDHEADS);
+  m_programTable =
+    pm->getProgram(GLProgramManager::CONNECTEDGATHER, "#define TABLE\n");
+  if (!m_programStarts || !m_programStartsPacked || !m_programRuns ||
+      !m_programPropagate || !m_programHook || !m_programChanged ||
+      !m_programSort || !m_programStats || !m_programReduce ||
+      !m_programHeads || !m_programTable) {
+    return false;
+  }
+  GLint program = m_programStarts;
+  m_uTextureStarts = glGetUniformLocation(program, "u_texture");
+
+  program = m_programStartsPacked;
+  m_uTextureStartsPacked = glGetUniformLocation(program, "u_texture");
+
+  program = m_programRuns;
+  m_uTableRuns = glGetUniformLocation(program, "u_table");
+  m_uSizeRuns = glGetUniformLocation(program, "u_size");
+  m_uListWidthRuns = glGetUniformLocation(program, "u_listWidth");
+  m_uCountRuns = glGetUniformLocation(program, "u_count");
+  m_uStartsRuns = glGetUniformLocation(program, "u_starts");
+
+  program = m_programPropagate;
+  m_uRunsPropagate = glGetUniformLocation(program, "u_runs");
+  m_uTablePropagate = glGetUniformLocation(program, "u_table");
+  m_uImageSizePropagate = glGetUniformLocation(program, "u_imageSize");
+  m_uListWidthPropagate = glGetUniformLocation(program, "u_listWidth");
+  m_uCountPropagate = glGetUniformLocation(program, "u_count");
+  m_uHooksPropagate = glGetUniformLocation(program, "u_hooks");
+
+  program = m_programHook;
+  m_uRunsHook = glGetUniformLocation(program, "u_runs");
+  m_uTableHook = glGetUniformLocation(program, "u_table");
+  m_uImageSizeHook = glGetUniformLocation(program, "u_imageSize");
+  m_uListSizeHook = glGetUniformLocation(program, "u_listSize");
+
+  program = m_programChanged;
+  m_uRunsChanged = glGetUniformLocation(program, "u_runs");
+  m_uPreviousChanged = glGetUniformLocation(program, "u_previous");
+
+  program = m_programSort;
+  m_uRunsSort = glGetUniformLocation(program, "u_runs");
+  m_uListWidthSort = glGetUniformLocation(program, "u_listWidth");
+  m_uBlockSort = glGetUniformLocation(program, "u_block");
+  m_uDistanceSort = glGetUniformLocation(program, "u_distance");
+
+  program = m_programStats;
+  m_uRunsStats = glGetUniformLocation(program, "u_runs");
+  m_uListWidthStats = glGetUniformLocation(program, "u_listWidth");
+
+  program = m_programReduce;
+  m_uRunsReduce = glGetUniformLocation(program, "u_runs");
+  m_uSumsReduce = glGetUniformLocation(program, "u_sums");
+  m_uExtentsReduce = glGetUniformLocation(program, "u_extents");
+  m_uListWidthReduce = glGetUniformLocation(program, "u_listWidth");
+  m_uCountReduce = glGetUniformLocation(program, "u_count");
+  m_uStepReduce = glGetUniformLocation(program, "u_step");
+
+  program = m_programHeads;
+  m_uRunsHeads = glGetUniformLocation(program, "u_runs");
+  m_uListWidthHeads = glGetUniformLocation(program, "u_listWidth");
+  m_uCountHeads = glGetUniformLocation(program, "u_count");
+
+  program = m_programTable;
+  m_uTableTable = glGetUniformLocation(program, "u_table");
+  m_uSizeTable = glGetUniformLocation(program, "u_size");
+  m_uListWidthTable = glGetUniformLocation(program, "u_listWidth");
+  m_uCountTable = glGetUniformLocation(program, "u_count");
+  m_uRunsTable = glGetUniformLocation(program, "u_runs");
+  m_uSumsTable = glGetUniformLocation(program, "u_sums");
+  m_uExtentsTable = glGetUniformLocation(program, "u_extents");
+  m_uColumnsTable = glGetUniformLocation(program, "u_columns");
+
+  GLint previous = 0;
+  GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glGenFramebuffers(1, &m_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glDrawBuffers(2, buffers);
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+  glGenQueries(1, &m_query);
+  return checkError("ConnectedComponentsProcessor::init");
+}
+
+ProcessorFootprint
+ConnectedComponentsProcessor::footprint() const
+{
+  return ProcessorFootprint{ s_wholeImageFootprint, s_wholeImageFootprint,
+                             s_wholeImageFootprint, s_wholeImageFootprint };
+}
+
+ProcessorExtent
+ConnectedComponentsProcessor::scratchExtent() const
+{
+  return SummedAreaTable::extent(ProcessorFootprint{ 0, 0, 0, 0 });
+}
+
+ProcessorOutput
+ConnectedComponentsProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLint width = pin.packed ? pin.pixelWidth : pin.width;
+  GLint imageSize[2] = { width, pin.height };
+  ProcessorFootprint none = { 0, 0, 0, 0 };
+  m_components.clear();
+  m_valid = false;
+  // a component may reach anywhere, whatever the scissor.
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_SCISSOR_TEST);
+
+  std::shared_ptr<GLTexture> starts =
+    wf->requestTextureForFramebuffer(width, pin.height, GL_RGBA);
+  glViewport(0, 0, width, pin.height);
+  wf->bindRenderTarget(starts.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  if (pin.packed) {
+    glUseProgram(m_programStartsPacked);
+    glUniform1i(m_uTextureStartsPacked, 0);
+  } else {
+    glUseProgram(m_programStarts);
+    glUniform1i(m_uTextureStarts, 0);
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  std::shared_ptr<GLTexture> ranks =
+    m_ranks.build(ProcessorInput{ width, pin.height, starts, wf }, none);
+  // logged by build().
+  GLint runs = ranks ? readEntry(wf, ranks.get(), width, pin.height) : -1;
+  // label, row, first and last column of the runs, as many entries as the
+  // next power of two for the sort.
+  GLint length = 1;
+  while (length < runs) {
+    length *= 2;
+  }
+  GLint listWidth = std::min(length, s_listWidth);
+  GLint listHeight = length / listWidth;
+  // the list is ranked by a summed-area table of its own, and the table
+  // read back has rows of s_tableColumns components.
+  ProcessorExtent extent = scratchExtent();
+  GLint tableRows = (runs + s_tableColumns - 1) / s_tableColumns;
+  if (runs < 0) {
+    runs = 0;
+  } else if (runs >= 1 << 24) {
+    // labels are compared as depths, exact up to 2^24.
+    GLIMPROC_LOGE("too many runs to label, %d.\n", runs);
+    runs = 0;
+  } else if (listHeight + extent.height > m_maxTextureSize ||
+             tableRows > m_maxTextureSize) {
+    GLIMPROC_LOGE("a list of %d runs exceeds the texture size.\n", runs);
+    runs = 0;
+  } else {
+    m_valid = true;
+  }
+
+  if (runs) {
+    GLint listSize[2] = { listWidth, listHeight };
+    std::shared_ptr<GLTexture> list =
+      wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA32UI);
+    std::shared_ptr<GLTexture> heads =
+      wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA);
+    glViewport(0, 0, listWidth, listHeight);
+    wf->bindRenderTarget(list.get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, starts->id());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, ranks->id());
+    glUseProgram(m_programRuns);
+    glUniform1i(m_uStartsRuns, 0);
+    glUniform1i(m_uTableRuns, 1);
+    glUniform2iv(m_uSizeRuns, 1, imageSize);
+    glUniform1i(m_uListWidthRuns, listWidth);
+    glUniform1i(m_uCountRuns, runs);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    starts.reset();
+    list = labelRuns(wf, list, ranks.get(), heads.get(), imageSize, listWidth,
+                     listHeight, runs);
+    list = sortRuns(wf, list, listWidth, listHeight);
+
+    std::shared_ptr<GLTexture> sums[2], extents[2];
+    for (size_t i = 0; i < 2; ++i) {
+      sums[i] =
+        wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA32UI);
+      extents[i] =
+        wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA32UI);
+    }
+    size_t current = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, sums[current]->id(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                           GL_TEXTURE_2D, extents[current]->id(), 0);
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, list->id());
+    glUseProgram(m_programStats);
+    glUniform1i(m_uRunsStats, 0);
+    glUniform1i(m_uListWidthStats, listWidth);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(m_programReduce);
+    glUniform1i(m_uRunsReduce, 0);
+    glUniform1i(m_uSumsReduce, 1);
+    glUniform1i(m_uExtentsReduce, 2);
+    glUniform1i(m_uListWidthReduce, listWidth);
+    glUniform1i(m_uCountReduce, runs);
+    for (GLint step = 1; step < runs; step *= 2) {
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, sums[current]->id());
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_2D, extents[current]->id());
+      current ^= 1;
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                             GL_TEXTURE_2D, sums[current]->id(), 0);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                             GL_TEXTURE_2D, extents[current]->id(), 0);
+      CHECK_FRAMEBUFFER_COMPLETE(wf);
+      glUniform1i(m_uStepReduce, step);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    // the pool may free them.
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, 0, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                           GL_TEXTURE_2D, 0, 0);
+
+    wf->bindRenderTarget(heads.get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(m_programHeads);
+    glUniform1i(m_uRunsHeads, 0);
+    glUniform1i(m_uListWidthHeads, listWidth);
+    glUniform1i(m_uCountHeads, runs);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    ranks =
+      m_ranks.build(ProcessorInput{ listWidth, listHeight, heads, wf }, none);
+    heads.reset();
+    GLint count = readEntry(wf, ranks.get(), listWidth, listHeight);
+
+    GLint columns = std::min(count, s_tableColumns);
+    GLint rows = (count + columns - 1) / columns;
+    std::shared_ptr<GLTexture> table =
+      wf->requestTextureForFramebuffer(2 * columns, rows, GL_RGBA32UI);
+    glViewport(0, 0, 2 * columns, rows);
+    wf->bindRenderTarget(table.get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, list->id());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, sums[current]->id());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, extents[current]->id());
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, ranks->id());
+    glUseProgram(m_programTable);
+    glUniform1i(m_uRunsTable, 0);
+    glUniform1i(m_uSumsTable, 1);
+    glUniform1i(m_uExtentsTable, 2);
+    glUniform1i(m_uTableTable, 3);
+    glUniform2iv(m_uSizeTable, 1, listSize);
+    glUniform1i(m_uListWidthTable, listWidth);
+    glUniform1i(m_uCountTable, count);
+    glUniform1i(m_uColumnsTable, columns);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    readComponents(wf, table.get(), columns, count);
+  }
+
+  glActiveTexture(GL_TEXTURE0);
+  glViewport(0, 0, pin.width, pin.height);
+  if (scissor) {
+    glEnable(GL_SCISSOR_TEST);
+  }
+  checkError("ConnectedComponentsProcessor::process");
+  return ProcessorOutput{ pin.color };
+}
+
+// labels stop changing once every run holds the smallest label of its
+// component, one plus the index of the component's first run.
+std::shared_ptr<GLTexture>
+ConnectedComponentsProcessor::labelRuns(ImageProcessorWorkflow* wf,
+                                        std::shared_ptr<GLTexture> runs,
+                                        GLTexture* ranks, GLTexture* scratch,
+                                        const GLint imageSize[2],
+                                        GLint listWidth, GLint listHeight,
+                                        GLint count)
+{
+  std::shared_ptr<GLTexture> lists[2] = {
+    std::move(runs),
+    wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA32UI)
+  };
+  GLint listSize[2] = { listWidth, listHeight };
+  prepareHooks(listWidth, listHeight);
+  size_t current = 0;
+  GLuint changed = 1;
+  // no run is hooked before the first pass.
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         m_hooks[0]->id(), 0);
+  glClearDepthf(1.0f);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  // the points need no quad, whose buffer holds four vertices only.
+  GLint quadEnabled;
+  glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &quadEnabled);
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, ranks->id());
+  while (changed) {
+    glActiveTexture(GL_TEXTURE0);
+    for (int i = 0; i < s_passesPerCheck; ++i) {
+      glBindTexture(GL_TEXTURE_2D, lists[current]->id());
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_2D, m_hooks[current]->id());
+      glActiveTexture(GL_TEXTURE0);
+      current ^= 1;
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                             GL_TEXTURE_2D, lists[current]->id(), 0);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                             GL_TEXTURE_2D, m_hooks[current]->id(), 0);
+      CHECK_FRAMEBUFFER_COMPLETE(wf);
+      glUseProgram(m_programPropagate);
+      glUniform1i(m_uRunsPropagate, 0);
+      glUniform1i(m_uTablePropagate, 1);
+      glUniform1i(m_uHooksPropagate, 2);
+      glUniform2iv(m_uImageSizePropagate, 1, imageSize);
+      glUniform1i(m_uListWidthPropagate, listWidth);
+      glUniform1i(m_uCountPropagate, count);
+      glDepthFunc(GL_ALWAYS);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+      // the labels just written stay as they are, only their hooks move.
+      glBindTexture(GL_TEXTURE_2D, lists[current]->id());
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      glUseProgram(m_programHook);
+      glUniform1i(m_uRunsHook, 0);
+      glUniform1i(m_uTableHook, 1);
+      glUniform2iv(m_uImageSizeHook, 1, imageSize);
+      glUniform2iv(m_uListSizeHook, 1, listSize);
+      glDepthFunc(GL_LESS);
+      glDisableVertexAttribArray(0);
+      glDrawArrays(GL_POINTS, 0, count);
+      if (quadEnabled) {
+        glEnableVertexAttribArray(0);
+      }
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+    // a pass leaving every label as it was has nothing left to do.
+    glDisable(GL_DEPTH_TEST);
+    wf->bindRenderTarget(scratch);
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glBindTexture(GL_TEXTURE_2D, lists[current]->id());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, lists[current ^ 1]->id());
+    glUseProgram(m_programChanged);
+    glUniform1i(m_uRunsChanged, 0);
+    glUniform1i(m_uPreviousChanged, 1);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, m_query);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glGetQueryObjectuiv(m_query, GL_QUERY_RESULT, &changed);
+    glBindTexture(GL_TEXTURE_2D, ranks->id());
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glEnable(GL_DEPTH_TEST);
+  }
+  glDisable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+  // the pool may free the list.
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         0, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         0, 0);
+  glActiveTexture(GL_TEXTURE0);
+  return lists[current];
+}
+
+void
+ConnectedComponentsProcessor::prepareHooks(GLint width, GLint height)
+{
+  if (width == m_hooksWidth && height == m_hooksHeight) {
+    return;
+  }
+  m_hooksWidth = width;
+  m_hooksHeight = height;
+  for (size_t i = 0; i < 2; ++i) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    m_hooks[i] = std::make_shared<GLTexture>(texture);
+    allocateTexture(texture, width, height, GL_DEPTH_COMPONENT32F);
+  }
+}
+
+std::shared_ptr<GLTexture>
+ConnectedComponentsProcessor::sortRuns(ImageProcessorWorkflow* wf,
+                                       std::shared_ptr<GLTexture> runs,
+                                       GLint listWidth, GLint listHeight)
+{
+  std::shared_ptr<GLTexture> lists[2] = {
+    std::move(runs),
+    wf->requestTextureForFramebuffer(listWidth, listHeight, GL_RGBA32UI)
+  };
+  GLint length = listWidth * listHeight;
+  size_t current = 0;
+  glActiveTexture(GL_TEXTURE0);
+  glUseProgram(m_programSort);
+  glUniform1i(m_uRunsSort, 0);
+  glUniform1i(m_uListWidthSort, listWidth);
+  for (GLint block = 2; block <= length; block *= 2) {
+    glUniform1i(m_uBlockSort, block);
+    for (GLint distance = block / 2; distance > 0; distance /= 2) {
+      glBindTexture(GL_TEXTURE_2D, lists[current]->id());
+      current ^= 1;
+      wf->bindRenderTarget(lists[current].get());
+      CHECK_FRAMEBUFFER_COMPLETE(wf);
+      glUniform1i(m_uDistanceSort, distance);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+  }
+  return lists[current];
+}
+
+// two texels per component: the first and last column and row, 16 bits
+// each, the area and the column sum, then the rest of the column sum, the
+// row sum and the label.
+void
+ConnectedComponentsProcessor::readComponents(ImageProcessorWorkflow* wf,
+                                             GLTexture* table, GLint columns,
+                                             GLint count)
+{
+  GLint rows = (count + columns - 1) / columns;
+  std::vector<GLuint> texels(8 * columns * rows);
+  wf->bindRenderTarget(table);
+  glReadPixels(0, 0, 2 * columns, rows, GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+               texels.data());
+  m_components.resize(count);
+  for (GLint i = 0; i < count; ++i) {
+    const GLuint* t = &texels[8 * i];
+    uint64_t sumX = t[3] | static_cast<uint64_t>(t[4]) << 32;
+    uint64_t sumY = t[5] | static_cast<uint64_t>(t[6]) << 32;
+    ConnectedComponent& c = m_components[i];
+    c.left = t[0] & 0xffff;
+    c.top = t[1] & 0xffff;
+    c.width = (t[0] >> 16) - c.left + 1;
+    c.height = (t[1] >> 16) - c.top + 1;
+    c.area = t[2];
+    c.centroidX = static_cast<double>(sumX) / t[2];
+    c.centroidY = static_cast<double>(sumY) / t[2];
+  }
+}
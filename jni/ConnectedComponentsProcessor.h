@@ -0,0 +1,147 @@
+#ifndef CONNECTEDCOMPONENTSPROCESSOR_H
+#define CONNECTEDCOMPONENTSPROCESSOR_H
+#include "IImageProcessor.h"
+#include "SummedAreaTable.h"
+#include <vector>
+
+class GLProgramManager;
+
+// a set of connected pixels whose red channel is nonzero, as a row of the
+// stats and centroids of cv::connectedComponentsWithStats. x and y are
+// counted from the first column and row of the image.
+struct ConnectedComponent
+{
+  GLint left, top, width, height;
+  GLint area;
+  double centroidX, centroidY;
+};
+
+// Labels the connected components of the image on the GPU and reads back
+// a table of them only, the image passes through unchanged (gles3). The
+// runs of the rows are compacted into a list, ranked by a summed-area
+// table of their starts. Each run starts with a label of its own and
+// takes the smallest label of the runs touching it in the rows above and
+// below pass after pass, following the labels it points to. Between the
+// passes each run also hooks the run its label names onto the smallest
+// label touching it, points scattered with a depth test keeping the
+// smallest, so that labels spread across whole chains of runs at once.
+// An occlusion query ends the passes once no label changes. The runs are
+// then sorted by label and added up per component in log-step passes, and
+// the first run of each component is compacted into the table. The
+// footprint spans the whole image, so images are never tiled and the
+// table always covers every pixel. Use OUTPUT_NONE when the table is all
+// the workflow is for.
+class ConnectedComponentsProcessor final : public IImageProcessor
+{
+public:
+  ConnectedComponentsProcessor();
+  ~ConnectedComponentsProcessor();
+  // connectivity is 4 or 8.
+  bool init(GLProgramManager* pm, int connectivity = 8);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  // the summed-area table ranking the runs.
+  ProcessorExtent scratchExtent() const override;
+  bool supportsPackedLuma() const override { return true; }
+  // the components of the last image by their first pixel in raster
+  // order, the background left out. empty, with valid() false, when the
+  // image could not be labeled.
+  const std::vector<ConnectedComponent>& components() const
+  {
+    return m_components;
+  }
+  // whether components() holds the components of the last image, false
+  // when its runs would not fit in the textures, with a log.
+  bool valid() const { return m_valid; }
+
+private:
+  std::shared_ptr<GLTexture> labelRuns(ImageProcessorWorkflow* wf,
+                                       std::shared_ptr<GLTexture> runs,
+                                       GLTexture* ranks, GLTexture* scratch,
+                                       const GLint imageSize[2],
+                                       GLint listWidth, GLint listHeight,
+                                       GLint count);
+  std::shared_ptr<GLTexture> sortRuns(ImageProcessorWorkflow* wf,
+                                      std::shared_ptr<GLTexture> runs,
+                                      GLint listWidth, GLint listHeight);
+  void readComponents(ImageProcessorWorkflow* wf, GLTexture* table,
+                      GLint columns, GLint count);
+  void prepareHooks(GLint width, GLint height);
+  SummedAreaTable m_ranks;
+  std::vector<ConnectedComponent> m_components;
+  bool m_valid;
+  GLint m_maxTextureSize;
+  // the labels are rendered with a depth attachment for the hooks, the
+  // statistics to two color attachments at once.
+  GLuint m_framebuffer;
+  GLuint m_query;
+  // the hooks, as depths, of this and the next pass.
+  std::shared_ptr<GLTexture> m_hooks[2];
+  GLint m_hooksWidth;
+  GLint m_hooksHeight;
+
+  GLint m_uTextureStarts;
+  GLint m_programStarts;
+
+  GLint m_uTextureStartsPacked;
+  GLint m_programStartsPacked;
+
+  GLint m_uTableRuns;
+  GLint m_uSizeRuns;
+  GLint m_uListWidthRuns;
+  GLint m_uCountRuns;
+  GLint m_uStartsRuns;
+  GLint m_programRuns;
+
+  GLint m_uRunsPropagate;
+  GLint m_uTablePropagate;
+  GLint m_uImageSizePropagate;
+  GLint m_uListWidthPropagate;
+  GLint m_uCountPropagate;
+  GLint m_uHooksPropagate;
+  GLint m_programPropagate;
+
+  GLint m_uRunsHook;
+  GLint m_uTableHook;
+  GLint m_uImageSizeHook;
+  GLint m_uListSizeHook;
+  GLint m_programHook;
+
+  GLint m_uRunsChanged;
+  GLint m_uPreviousChanged;
+  GLint m_programChanged;
+
+  GLint m_uRunsSort;
+  GLint m_uListWidthSort;
+  GLint m_uBlockSort;
+  GLint m_uDistanceSort;
+  GLint m_programSort;
+
+  GLint m_uRunsStats;
+  GLint m_uListWidthStats;
+  GLint m_programStats;
+
+  GLint m_uRunsReduce;
+  GLint m_uSumsReduce;
+  GLint m_uExtentsReduce;
+  GLint m_uListWidthReduce;
+  GLint m_uCountReduce;
+  GLint m_uStepReduce;
+  GLint m_programReduce;
+
+  GLint m_uRunsHeads;
+  GLint m_uListWidthHeads;
+  GLint m_uCountHeads;
+  GLint m_programHeads;
+
+  GLint m_uTableTable;
+  GLint m_uSizeTable;
+  GLint m_uListWidthTable;
+  GLint m_uCountTable;
+  GLint m_uRunsTable;
+  GLint m_uSumsTable;
+  GLint m_uExtentsTable;
+  GLint m_uColumnsTable;
+  GLint m_programTable;
+};
+#endif /* CONNECTEDCOMPONENTSPROCESSOR_H */
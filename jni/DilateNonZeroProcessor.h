@@ -1,6 +1,11 @@
 #ifndef DILATENONZEROPROCESSOR_H
 #define DILATENONZEROPROCESSOR_H
 #include "IImageProcessor.h"
+#include "MorphologyDoubling.h"
+#include "MorphologyMask.h"
+#include "MorphologyScan.h"
+#include "StructuringElement.h"
+#include <vector>
 class GLProgramManager;
 
 class DilateNonZeroProcessor final : public IImageProcessor
@@ -10,20 +15,50 @@ public:
   ~DilateNonZeroProcessor();
   bool init(GLProgramManager* pm, unsigned kwidth, unsigned kheight,
             unsigned iterations);
+  // any element, decomposed into separable rectangles whose results are
+  // merged, or applied through its mask when that is cheaper.
+  bool init(GLProgramManager* pm, const StructuringElement& element,
+            unsigned iterations = 1);
   ProcessorOutput process(const ProcessorInput& desc) override;
+  bool describe(ProcessorDescription* desc) const override;
+  ProcessorFootprint footprint() const override;
+  ProcessorExtent scratchExtent() const override;
+  bool supportsPackedLuma() const override { return true; }
 
 private:
   bool initProgram(GLProgramManager* pm);
+  // the window of size pixels starting before pixels left of each pixel.
+  void rowPass(const ProcessorInput& pin, GLTexture* source, GLint size,
+               GLint before, GLTexture* target);
+  // the window of size rows starting before rows below each pixel.
+  void columnPass(const ProcessorInput& pin, GLTexture* source, GLint size,
+                  GLint before, GLTexture* target);
   GLint m_uTextureRow;
   GLint m_uScreenGeometryRow;
   GLint m_uKWidthRow;
+  GLint m_uKAnchorRow;
   GLint m_programRow;
 
+  GLint m_uTextureRowPacked;
+  GLint m_uScreenGeometryRowPacked;
+  GLint m_uImageWidthRowPacked;
+  GLint m_uKWidthRowPacked;
+  GLint m_uKAnchorRowPacked;
+  GLint m_programRowPacked;
+
   GLint m_uTextureColumn;
   GLint m_uScreenGeometryColumn;
   GLint m_uKHeightColumn;
+  GLint m_uKAnchorColumn;
   GLint m_programColumn;
+  // zero unless the element is the rectangle init(kwidth, kheight) makes.
   unsigned m_kwidth;
   unsigned m_kheight;
+  StructuringElement m_element;
+  std::vector<StructuringElement::Rectangle> m_rectangles;
+  // the passes MorphologyPlan::choose() does not run directly.
+  MorphologyScan m_scan;
+  MorphologyDoubling m_doubling;
+  MorphologyMask m_mask;
 };
 #endif /* DILATENONZEROPROCESSOR_H */
@@ -8,11 +8,20 @@ ErodeNonZeroProcessor::ErodeNonZeroProcessor()
   : m_uTextureRow(0)
   , m_uScreenGeometryRow(0)
   , m_uKWidthRow(0)
+  , m_uKAnchorRow(0)
   , m_programRow(0)
 
+  , m_uTextureRowPacked(0)
+  , m_uScreenGeometryRowPacked(0)
+  , m_uImageWidthRowPacked(0)
+  , m_uKWidthRowPacked(0)
+  , m_uKAnchorRowPacked(0)
+  , m_programRowPacked(0)
+
   , m_uTextureColumn(0)
   , m_uScreenGeometryColumn(0)
   , m_uKHeightColumn(0)
+  , m_uKAnchorColumn(0)
   , m_programColumn(0)
   , m_kwidth(0)
   , m_kheight(0)
@@ -27,9 +36,35 @@ bool
 ErodeNonZeroProcessor::init(GLProgramManager* pm, unsigned kwidth,
                             unsigned kheight, unsigned iterations)
 {
-  m_kwidth = kwidth + (kwidth - 1) * (iterations - 1);
-  m_kheight = kheight + (kheight - 1) * (iterations - 1);
-  return initProgram(pm);
+  GLint width = kwidth + (kwidth - 1) * (iterations - 1);
+  GLint height = kheight + (kheight - 1) * (iterations - 1);
+  // for even heights the column window has always taken one row more
+  // after the pixel than before it.
+  return init(pm, StructuringElement::rectangle(width, height, width / 2,
+                                                height - 1 - height / 2));
+}
+
+bool
+ErodeNonZeroProcessor::init(GLProgramManager* pm,
+                            const StructuringElement& element,
+                            unsigned iterations)
+{
+  if (element.empty() || !iterations) {
+    GLIMPROC_LOGE("the structuring element sets no pixel.\n");
+    return false;
+  }
+  m_element = element.repeated(iterations);
+  m_rectangles = m_element.decompose();
+  m_kwidth = 0;
+  m_kheight = 0;
+  if (m_rectangles.size() == 1) {
+    const StructuringElement::Rectangle& r = m_rectangles[0];
+    if (r.x == -(r.width / 2) && r.y == -(r.height - 1 - r.height / 2)) {
+      m_kwidth = r.width;
+      m_kheight = r.height;
+    }
+  }
+  return initProgram(pm) && m_mask.init(pm, false, m_element);
 }
 
 ProcessorOutput
@@ -37,51 +72,141 @@ ErodeNonZeroProcessor::process(const ProcessorInput& pin)
 {
   ImageProcessorWorkflow* wf = pin.wf;
   FBOScope fboscope(wf);
-  // zero for row process, one for column process
-  std::shared_ptr<GLTexture> tmpTexture[2] = {
-    wf->requestTextureForFramebuffer(), wf->requestTextureForFramebuffer()
-  };
-
-  // bind fbo and complete it.
-  wf->setColorAttachmentForFramebuffer(tmpTexture[0]->id());
-
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d, %x.\n", __LINE__,
-                  wf->checkFramebuffer());
-    exit(1);
+  if (!pin.packed && MorphologyPlan::maskCost(pin, m_element) <
+                       MorphologyPlan::cost(pin, m_rectangles)) {
+    std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+    m_mask.process(pin, pin.color.get(), target.get());
+    return ProcessorOutput{ target };
   }
+  std::shared_ptr<GLTexture> result;
+  for (const auto& r : m_rectangles) {
+    // a window of the pixel alone leaves the image as it is.
+    std::shared_ptr<GLTexture> image = pin.color;
+    if (r.width != 1 || r.x != 0) {
+      std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+      rowPass(pin, image.get(), r.width, -r.x, target.get());
+      image = target;
+    }
+    if (r.height != 1 || r.y != 0) {
+      std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+      columnPass(pin, image.get(), r.height, -r.y, target.get());
+      image = target;
+    }
+    if (result) {
+      std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+      m_mask.merge(pin, result.get(), image.get(), target.get());
+      image = target;
+    }
+    result = image;
+  }
+  return ProcessorOutput{ result };
+}
+
+void
+ErodeNonZeroProcessor::rowPass(const ProcessorInput& pin, GLTexture* source,
+                               GLint size, GLint before, GLTexture* target)
+{
+  MorphologyPlan::Method method =
+    MorphologyPlan::choose(pin, MorphologyPlan::ROW, size);
+  if (method == MorphologyPlan::SCAN) {
+    m_scan.process(pin, source, MorphologyPlan::ROW, size, before, target);
+    return;
+  }
+  if (method == MorphologyPlan::DOUBLING) {
+    m_doubling.process(pin, source, MorphologyPlan::ROW, size, before,
+                       target);
+    return;
+  }
+  ImageProcessorWorkflow* wf = pin.wf;
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(target);
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
   GLint imageGeometry[2] = { pin.width, pin.height };
-  glUseProgram(m_programRow);
-  // setup uniforms
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, pin.color->id());
-  glUniform1i(m_uTextureRow, 0);
+  glBindTexture(GL_TEXTURE_2D, source->id());
+  if (pin.packed) {
+    // the column pass works on packed texels as is.
+    glUseProgram(m_programRowPacked);
+    glUniform1i(m_uTextureRowPacked, 0);
+    glUniform2iv(m_uScreenGeometryRowPacked, 1, imageGeometry);
+    glUniform1f(m_uImageWidthRowPacked, static_cast<GLfloat>(pin.pixelWidth));
+    glUniform1i(m_uKWidthRowPacked, size);
+    glUniform1i(m_uKAnchorRowPacked, before);
+  } else {
+    glUseProgram(m_programRow);
+    // setup uniforms
+    glUniform1i(m_uTextureRow, 0);
 
-  glUniform2iv(m_uScreenGeometryRow, 1, imageGeometry);
-  // setup kernel and block size
+    glUniform2iv(m_uScreenGeometryRow, 1, imageGeometry);
+    // setup kernel and block size
 
-  glUniform1i(m_uKWidthRow, m_kwidth);
+    glUniform1i(m_uKWidthRow, size);
+    glUniform1i(m_uKAnchorRow, before);
+  }
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
 
-  // bind fbo and complete it.
-  wf->setColorAttachmentForFramebuffer(tmpTexture[1]->id());
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d.\n", __LINE__);
-    exit(1);
+void
+ErodeNonZeroProcessor::columnPass(const ProcessorInput& pin,
+                                  GLTexture* source, GLint size,
+                                  GLint before, GLTexture* target)
+{
+  MorphologyPlan::Method method =
+    MorphologyPlan::choose(pin, MorphologyPlan::COLUMN, size);
+  if (method == MorphologyPlan::SCAN) {
+    m_scan.process(pin, source, MorphologyPlan::COLUMN, size, before,
+                   target);
+    return;
+  }
+  if (method == MorphologyPlan::DOUBLING) {
+    m_doubling.process(pin, source, MorphologyPlan::COLUMN, size, before,
+                       target);
+    return;
   }
+  ImageProcessorWorkflow* wf = pin.wf;
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(target);
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
 
   glUseProgram(m_programColumn);
   // setup uniforms
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, tmpTexture[0]->id());
+  glBindTexture(GL_TEXTURE_2D, source->id());
   glUniform1i(m_uTextureColumn, 0);
 
   glUniform2iv(m_uScreenGeometryColumn, 1, imageGeometry);
   // setup kernel and block size
 
-  glUniform1i(m_uKHeightColumn, m_kheight);
+  glUniform1i(m_uKHeightColumn, size);
+  // the shader walks down from the top of the window.
+  glUniform1i(m_uKAnchorColumn, size - 1 - before);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  return ProcessorOutput{ tmpTexture[1] };
+}
+
+bool
+ErodeNonZeroProcessor::describe(ProcessorDescription* desc) const
+{
+  if (!m_kwidth) {
+    return false;
+  }
+  *desc = ProcessorDescription();
+  desc->kind = ProcessorDescription::ERODE_NONZERO;
+  desc->kwidth = m_kwidth;
+  desc->kheight = m_kheight;
+  return true;
+}
+
+ProcessorFootprint
+ErodeNonZeroProcessor::footprint() const
+{
+  return m_element.footprint();
+}
+
+ProcessorExtent
+ErodeNonZeroProcessor::scratchExtent() const
+{
+  return MorphologyPlan::extent(m_rectangles);
 }
 
 bool
@@ -89,21 +214,33 @@ ErodeNonZeroProcessor::initProgram(GLProgramManager* pm)
 {
   m_programRow = pm->getProgram(GLProgramManager::ERODENONZEROROW);
   m_programColumn = pm->getProgram(GLProgramManager::ERODENONZEROCOLUMN);
-  if (!m_programRow || !m_programColumn) {
+  m_programRowPacked = pm->getProgram(GLProgramManager::ERODENONZEROROWPACKED);
+  if (!m_programRow || !m_programColumn || !m_programRowPacked ||
+      !m_scan.init(pm, false) || !m_doubling.init(pm, false)) {
     return false;
   }
   GLuint program = m_programRow;
   m_uTextureRow = glGetUniformLocation(program, "u_texture");
   m_uScreenGeometryRow = glGetUniformLocation(program, "u_screenGeometry");
   m_uKWidthRow = glGetUniformLocation(program, "u_kRowSize");
+  m_uKAnchorRow = glGetUniformLocation(program, "u_kRowAnchor");
   GLIMPROC_LOGI(
     "m_uTextureRow: %d, m_uScreenGeometryRow: %d, m_uKWidthRow: %d.\n",
     m_uTextureRow, m_uScreenGeometryRow, m_uKWidthRow);
 
+  program = m_programRowPacked;
+  m_uTextureRowPacked = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryRowPacked =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uImageWidthRowPacked = glGetUniformLocation(program, "u_imageWidth");
+  m_uKWidthRowPacked = glGetUniformLocation(program, "u_kRowSize");
+  m_uKAnchorRowPacked = glGetUniformLocation(program, "u_kRowAnchor");
+
   program = m_programColumn;
   m_uTextureColumn = glGetUniformLocation(program, "u_texture");
   m_uScreenGeometryColumn = glGetUniformLocation(program, "u_screenGeometry");
   m_uKHeightColumn = glGetUniformLocation(program, "u_kColumnSize");
+  m_uKAnchorColumn = glGetUniformLocation(program, "u_kColumnAnchor");
   GLIMPROC_LOGI(
     "m_uTextureColumn: %d, m_uScreenGeometryColumn: %d, m_uKHeightColumn: "
     "%d.\n",
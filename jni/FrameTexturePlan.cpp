@@ -0,0 +1,147 @@
+#include "FrameTexturePlan.h"
+#include "GLResources.h"
+#include "GLTexturePool.h"
+#include <algorithm>
+
+static const size_t s_live = static_cast<size_t>(-1);
+
+static size_t
+bytesOf(GLint width, GLint height, GLenum internalFormat)
+{
+  return static_cast<size_t>(width) * height * bytesPerPixel(internalFormat);
+}
+
+FrameTexturePlan::FrameTexturePlan(std::shared_ptr<GLTexturePool> pool)
+  : m_pool(std::move(pool))
+  , m_clock(0)
+  , m_next(0)
+  , m_peakBytes(0)
+  , m_allocatedBytes(0)
+  , m_recording(false)
+  , m_planned(false)
+  , m_bypass(false)
+{
+}
+
+void
+FrameTexturePlan::beginFrame()
+{
+  if (m_recording) {
+    m_recording = false;
+    finishRecording();
+  }
+  m_next = 0;
+  m_bypass = false;
+  if (!m_planned) {
+    m_requests.clear();
+    m_textures.clear();
+    m_clock = 0;
+    m_recording = true;
+    return;
+  }
+  // a texture of the previous frame is still held, the output most likely.
+  for (auto& texture : m_textures) {
+    if (texture.use_count() > 1) {
+      m_bypass = true;
+      return;
+    }
+  }
+}
+
+std::shared_ptr<GLTexture>
+FrameTexturePlan::acquire(GLint width, GLint height, GLenum internalFormat)
+{
+  if (m_recording) {
+    size_t index = m_requests.size();
+    m_requests.push_back(
+      Request{ width, height, internalFormat, m_clock++, s_live });
+    std::shared_ptr<GLTexture> texture =
+      m_pool->acquire(width, height, internalFormat);
+    std::weak_ptr<FrameTexturePlan> plan = shared_from_this();
+    return std::shared_ptr<GLTexture>(
+      texture.get(), [texture, plan, index](GLTexture*) mutable {
+        std::shared_ptr<FrameTexturePlan> p = plan.lock();
+        if (p) {
+          p->recordRelease(index);
+        }
+        texture.reset();
+      });
+  }
+  if (m_bypass || !m_planned) {
+    return m_pool->acquire(width, height, internalFormat);
+  }
+  if (m_next >= m_requests.size() || m_requests[m_next].width != width ||
+      m_requests[m_next].height != height ||
+      m_requests[m_next].internalFormat != internalFormat) {
+    GLIMPROC_LOGI("frame does not follow its texture plan, replanning.\n");
+    m_planned = false;
+    m_bypass = true;
+    return m_pool->acquire(width, height, internalFormat);
+  }
+  return m_textures[m_assignment[m_next++]];
+}
+
+void
+FrameTexturePlan::recordRelease(size_t request)
+{
+  if (m_recording) {
+    m_requests[request].released = m_clock++;
+  }
+}
+
+void
+FrameTexturePlan::finishRecording()
+{
+  struct Physical
+  {
+    GLint width, height;
+    GLenum internalFormat;
+    // release time of the last request assigned, s_live while held.
+    size_t freeAt;
+  };
+  std::vector<Physical> physicals;
+  m_assignment.clear();
+  m_peakBytes = 0;
+  // requests are in order of acquisition, so assigning each to any free
+  // texture of its kind uses the fewest textures.
+  for (auto& request : m_requests) {
+    size_t chosen = physicals.size();
+    for (size_t i = 0; i < physicals.size(); ++i) {
+      const Physical& p = physicals[i];
+      if (p.width == request.width && p.height == request.height &&
+          p.internalFormat == request.internalFormat &&
+          p.freeAt != s_live && p.freeAt < request.acquired) {
+        chosen = i;
+        break;
+      }
+    }
+    if (chosen == physicals.size()) {
+      physicals.push_back(Physical{ request.width, request.height,
+                                    request.internalFormat, 0 });
+    }
+    physicals[chosen].freeAt = request.released;
+    m_assignment.push_back(chosen);
+
+    // everything acquired before and released after is live with it.
+    size_t live = 0;
+    for (auto& other : m_requests) {
+      if (other.acquired <= request.acquired &&
+          (other.released == s_live || other.released > request.acquired)) {
+        live += bytesOf(other.width, other.height, other.internalFormat);
+      }
+    }
+    m_peakBytes = std::max(m_peakBytes, live);
+  }
+
+  m_textures.clear();
+  m_allocatedBytes = 0;
+  for (auto& p : physicals) {
+    m_textures.push_back(m_pool->acquire(p.width, p.height, p.internalFormat));
+    m_allocatedBytes += bytesOf(p.width, p.height, p.internalFormat);
+  }
+  m_planned = true;
+  GLIMPROC_LOGI("texture plan: %zu requests in %zu textures, %zu bytes at "
+                "peak, %zu allocated.\n",
+                m_requests.size(), m_textures.size(), m_peakBytes,
+                m_allocatedBytes);
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMETEXTUREPLAN_H
+#define FRAMETEXTUREPLAN_H
+#include "GLCommon.h"
+#include <memory>
+#include <stddef.h>
+#include <vector>
+
+class GLTexture;
+class GLTexturePool;
+
+// Render targets of the frames of one geometry. The first frame takes
+// its textures from the pool and records when each one is requested and
+// released, temporaries inside processors included. Those lifetimes are
+// then colored like intervals: requests of the same size and format share
+// one physical texture whenever they are never live at once. Later frames
+// get the physical textures in request order without allocating.
+class FrameTexturePlan final
+  : public std::enable_shared_from_this<FrameTexturePlan>
+{
+public:
+  explicit FrameTexturePlan(std::shared_ptr<GLTexturePool> pool);
+  // finishes the plan if the previous frame recorded it.
+  void beginFrame();
+  std::shared_ptr<GLTexture> acquire(GLint width, GLint height,
+                                     GLenum internalFormat);
+  inline bool planned() const { return m_planned; }
+  // bytes live at once at the worst point of a frame.
+  inline size_t peakBytes() const { return m_peakBytes; }
+  // bytes of the physical textures the plan holds.
+  inline size_t allocatedBytes() const { return m_allocatedBytes; }
+  inline size_t textureCount() const { return m_textures.size(); }
+
+private:
+  struct Request
+  {
+    GLint width, height;
+    GLenum internalFormat;
+    size_t acquired, released;
+  };
+  void recordRelease(size_t request);
+  void finishRecording();
+  std::shared_ptr<GLTexturePool> m_pool;
+  std::vector<Request> m_requests;
+  // physical texture of each request.
+  std::vector<size_t> m_assignment;
+  std::vector<std::shared_ptr<GLTexture>> m_textures;
+  size_t m_clock;
+  size_t m_next;
+  size_t m_peakBytes;
+  size_t m_allocatedBytes;
+  bool m_recording;
+  bool m_planned;
+  // this frame does not follow the plan and takes from the pool.
+  bool m_bypass;
+};
+#endif /* FRAMETEXTUREPLAN_H */
@@ -0,0 +1,167 @@
+#include "FusedPassProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+appendf(std::string* s, const char* fmt, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  s->append(buf);
+}
+
+static std::string
+glslFloat(GLfloat value)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", value);
+  std::string s(buf);
+  if (s.find_first_of(".e") == std::string::npos) {
+    s.append(".0");
+  }
+  return s;
+}
+
+FusedPassProcessor::FusedPassProcessor()
+  : m_uTexture(0)
+  , m_uScreenGeometry(0)
+  , m_program(0)
+  , m_footprint{ 0, 0, 0, 0 }
+{
+}
+
+bool
+FusedPassProcessor::init(GLProgramManager* pm, const FusedPass& pass)
+{
+  m_footprint = pass.footprint();
+  m_program = pm->getProgram(generateSource(pass));
+  if (!m_program) {
+    return false;
+  }
+  GLint program = m_program;
+  m_uTexture = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometry = glGetUniformLocation(program, "u_screenGeometry");
+  GLIMPROC_LOGI("m_uTexture: %d, m_uScreenGeometry: %d.\n", m_uTexture,
+                m_uScreenGeometry);
+  return true;
+}
+
+// Every stage of the unfused chain samples its input with
+// GL_MIRRORED_REPEAT, so the generated shader walks texel coordinates
+// through the same mirroring between stages instead of leaving it to the
+// sampler once.
+std::string
+FusedPassProcessor::generateSource(const FusedPass& pass)
+{
+  std::string s;
+  s.append("uniform ivec2 u_screenGeometry;\n"
+           "uniform sampler2D u_texture;\n"
+           "\n"
+           "highp vec2 mirrorTexel(highp vec2 t)\n"
+           "{\n"
+           "    highp vec2 size = vec2(u_screenGeometry);\n"
+           "    highp vec2 m = mod(t, 2.0 * size);\n"
+           "    return mix(m, 2.0 * size - 1.0 - m, step(size, m));\n"
+           "}\n"
+           "\n"
+           "highp vec4 fetch(highp vec2 t)\n"
+           "{\n"
+           "    highp vec4 v;\n");
+  for (auto it = pass.points.rbegin(); it != pass.points.rend(); ++it) {
+    if (it->offsetX != 0 || it->offsetY != 0) {
+      appendf(&s, "    t = mirrorTexel(t + vec2(%d.0, %d.0));\n", it->offsetX,
+              it->offsetY);
+    }
+  }
+  s.append("    v = texture2D(u_texture, (t + 0.5) / "
+           "vec2(u_screenGeometry));\n");
+  for (auto& point : pass.points) {
+    GLfloat threshold = static_cast<GLfloat>(point.threshold) / 255.0f;
+    GLfloat maxValue = static_cast<GLfloat>(point.maxValue) / 255.0f;
+    appendf(&s, "    v = vec4(v.r > %s ? %s : 0.0);\n",
+            glslFloat(threshold).c_str(), glslFloat(maxValue).c_str());
+  }
+  s.append("    return v;\n"
+           "}\n"
+           "\n"
+           "void main(void)\n"
+           "{\n"
+           "    highp vec2 t0 = floor(gl_FragCoord.xy);\n");
+  // the last line is the outermost loop.
+  size_t depth = pass.lines.size();
+  std::string indent("    ");
+  for (size_t level = 1; level <= depth; ++level) {
+    const FusedPass::Line& line = pass.lines[depth - level];
+    const char* init = line.op == FusedPass::MAX ? "0.0" : "0.9999999";
+    appendf(&s, "%shighp vec4 m%zu = vec4(%s);\n", indent.c_str(), level,
+            init);
+    appendf(&s, "%sfor (int j%zu = 0; j%zu < %u; ++j%zu) {\n", indent.c_str(),
+            level, level, line.size, level);
+    if (line.axis == FusedPass::ROW) {
+      appendf(&s, "%s    highp vec2 t%zu = mirrorTexel(t%zu + "
+                  "vec2(float(j%zu) - %u.0, 0.0));\n",
+              indent.c_str(), level, level - 1, level, line.size / 2);
+    } else {
+      appendf(&s, "%s    highp vec2 t%zu = mirrorTexel(t%zu + "
+                  "vec2(0.0, %u.0 - float(j%zu)));\n",
+              indent.c_str(), level, level - 1, line.size / 2, level);
+    }
+    indent.append("    ");
+  }
+  if (depth == 0) {
+    s.append("    gl_FragColor = fetch(t0);\n");
+  } else {
+    appendf(&s, "%shighp vec4 m%zu = fetch(t%zu);\n", indent.c_str(),
+            depth + 1, depth);
+  }
+  for (size_t level = depth; level >= 1; --level) {
+    const FusedPass::Line& line = pass.lines[depth - level];
+    const char* op = line.op == FusedPass::MAX ? "max" : "min";
+    appendf(&s, "%sm%zu = %s(m%zu, m%zu);\n", indent.c_str(), level, op,
+            level, level + 1);
+    indent.resize(indent.size() - 4);
+    appendf(&s, "%s}\n", indent.c_str());
+  }
+  if (depth != 0) {
+    s.append("    gl_FragColor = m1;\n");
+  }
+  s.append("}\n");
+  return s;
+}
+
+ProcessorFootprint
+FusedPassProcessor::footprint() const
+{
+  return m_footprint;
+}
+
+ProcessorOutput
+FusedPassProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  std::shared_ptr<GLTexture> tmpTexture[1] = {
+    wf->requestTextureForFramebuffer()
+  };
+
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
+  glUseProgram(m_program);
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  glUniform1i(m_uTexture, 0);
+
+  glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  return ProcessorOutput{ tmpTexture[0] };
+}
@@ -0,0 +1,27 @@
+#ifndef FUSEDPASSPROCESSOR_H
+#define FUSEDPASSPROCESSOR_H
+#include "IImageProcessor.h"
+#include "PassFusionPlanner.h"
+#include <string>
+
+class GLProgramManager;
+
+// Runs one pass of a fused plan with a program generated for it.
+class FusedPassProcessor final : public IImageProcessor
+{
+public:
+  FusedPassProcessor();
+  ~FusedPassProcessor() = default;
+  bool init(GLProgramManager* pm, const FusedPass& pass);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  static std::string generateSource(const FusedPass& pass);
+
+private:
+  GLint m_uTexture;
+  GLint m_uScreenGeometry;
+  GLint m_program;
+  ProcessorFootprint m_footprint;
+};
+
+#endif /* FUSEDPASSPROCESSOR_H */
@@ -1,6 +1,7 @@
 #include "GLCommon.h"
 #include <EGL/egl.h>
 #include <stdlib.h>
+#include <string.h>
 
 bool
 checkError(const char* functionName)
@@ -14,6 +15,17 @@ checkError(const char* functionName)
   return !entered;
 }
 
+bool
+isGLES3Context()
+{
+  static const char s_prefix[] = "OpenGL ES ";
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (!version || strncmp(version, s_prefix, sizeof(s_prefix) - 1) != 0) {
+    return false;
+  }
+  return version[sizeof(s_prefix) - 1] >= '3';
+}
+
 void
 checkContextNotNull(int line, const char* file)
 {
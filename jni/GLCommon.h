@@ -4,6 +4,8 @@
 #include <GLES2/gl2.h>
 /* report GL errors, if any, to stderr */
 bool checkError(const char* functionName);
+/* whether the current context implements GLES 3.0 or later */
+bool isGLES3Context();
 
 // check for empty context
 #if defined(GL_NO_ADDITIONAL_CHECK)
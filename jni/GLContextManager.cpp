@@ -3,7 +3,8 @@
 #define EGL_OPENGL_ES3_BIT_KHR 0x00000040
 
 GLContextManager::GLContextManager()
-  : m_dpy(EGL_NO_DISPLAY)
+  : m_clientVersion(0)
+  , m_dpy(EGL_NO_DISPLAY)
   , m_context(EGL_NO_CONTEXT)
   , m_surface(EGL_NO_SURFACE)
 {
@@ -22,7 +23,8 @@ GLContextManager::~GLContextManager()
 }
 
 bool
-GLContextManager::init()
+GLContextManager::init(EGLint clientVersion,
+                       const GLContextManager* shareWith)
 {
   EGLConfig config;
   EGLSurface surface;
@@ -32,19 +34,21 @@ GLContextManager::init()
     return false;
   }
 
-  static const GLint configAttribs[] = { EGL_SURFACE_TYPE,
-                                         EGL_PBUFFER_BIT,
-                                         EGL_RENDERABLE_TYPE,
-                                         EGL_OPENGL_ES2_BIT,
-                                         EGL_RED_SIZE,
-                                         8,
-                                         EGL_GREEN_SIZE,
-                                         8,
-                                         EGL_BLUE_SIZE,
-                                         8,
-                                         EGL_ALPHA_SIZE,
-                                         8,
-                                         EGL_NONE };
+  EGLint renderableType =
+    clientVersion >= 3 ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT;
+  const GLint configAttribs[] = { EGL_SURFACE_TYPE,
+                                  EGL_PBUFFER_BIT,
+                                  EGL_RENDERABLE_TYPE,
+                                  renderableType,
+                                  EGL_RED_SIZE,
+                                  8,
+                                  EGL_GREEN_SIZE,
+                                  8,
+                                  EGL_BLUE_SIZE,
+                                  8,
+                                  EGL_ALPHA_SIZE,
+                                  8,
+                                  EGL_NONE };
 
   if (!eglChooseConfig(dpy, configAttribs, &config, 1, &n)) {
     return false;
@@ -57,15 +61,16 @@ GLContextManager::init()
     return NULL;
   }
 
-  static const GLint gl2ContextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2,
-                                             EGL_NONE };
+  const GLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, clientVersion,
+                                  EGL_NONE };
 
-  EGLContext ctx =
-    eglCreateContext(dpy, config, EGL_NO_CONTEXT, gl2ContextAttribs);
+  EGLContext shareContext = shareWith ? shareWith->m_context : EGL_NO_CONTEXT;
+  EGLContext ctx = eglCreateContext(dpy, config, shareContext, contextAttribs);
   if (ctx == EGL_NO_CONTEXT) {
     eglDestroySurface(dpy, surface);
     return false;
   }
+  m_clientVersion = clientVersion;
   m_dpy = dpy;
   m_context = ctx;
   m_surface = surface;
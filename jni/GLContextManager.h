@@ -9,9 +9,15 @@ class GLContextManager
 public:
   GLContextManager();
   ~GLContextManager();
-  bool init();
+  // clientVersion 3 asks for a GLES3 context, needed for asynchronous
+  // readback. with shareWith the context joins the share group of that
+  // one.
+  bool init(EGLint clientVersion = 2,
+            const GLContextManager* shareWith = nullptr);
+  inline EGLint clientVersion() const { return m_clientVersion; }
 
 private:
+  EGLint m_clientVersion;
   EGLDisplay m_dpy;
   EGLContext m_context;
   EGLSurface m_surface;
@@ -1,4 +1,5 @@
 #include "GLProgramManager.h"
+#include <string.h>
 
 extern "C" {
 extern const char* const gaussianFragRowSource;
@@ -9,7 +10,52 @@ extern const char* const dilateNonZeroColumnSource;
 extern const char* const erodeNonZeroRowSource;
 extern const char* const erodeNonZeroColumnSource;
 extern const char* const thresholdSource;
+extern const char* const packGraySource;
+extern const char* const packBinarySource;
+extern const char* const subtractSource;
+extern const char* const gaussianFragRowPackedSource;
+extern const char* const gaussianFragColumnPackedSource;
+extern const char* const adaptiveThresholdPackedSource;
+extern const char* const dilateNonZeroRowPackedSource;
+extern const char* const erodeNonZeroRowPackedSource;
+extern const char* const thresholdPackedSource;
+extern const char* const subtractPackedSource;
+extern const char* const unpackGraySource;
+extern const char* const gaussianFragRowLinearSource;
+extern const char* const gaussianFragColumnLinearSource;
+extern const char* const gaussianFragColumnPackedLinearSource;
+extern const char* const summedAreaSeedSource;
+extern const char* const summedAreaSeedPackedSource;
+extern const char* const summedAreaRowSource;
+extern const char* const summedAreaColumnSource;
+extern const char* const adaptiveMeanSource;
+extern const char* const adaptiveMeanPackedSource;
+extern const char* const adaptiveReduceSource;
+extern const char* const adaptivePyramidSource;
+extern const char* const localDeviationThresholdSource;
+extern const char* const morphologyScanVertexSource;
+extern const char* const morphologyScanSource;
+extern const char* const morphologyCombineSource;
+extern const char* const morphologyDoublingSource;
+extern const char* const morphologyMaskSource;
+extern const char* const morphologyMergeSource;
+extern const char* const histogramScatterVertexSource;
+extern const char* const histogramScatterSource;
+extern const char* const histogramReduceSource;
+extern const char* const otsuSource;
+extern const char* const otsuThresholdSource;
+extern const char* const connectedStartsSource;
+extern const char* const connectedGatherSource;
+extern const char* const connectedPropagateSource;
+extern const char* const connectedHookVertexSource;
+extern const char* const connectedHookSource;
+extern const char* const connectedChangedSource;
+extern const char* const connectedSortSource;
+extern const char* const connectedStatsSource;
+extern const char* const connectedReduceSource;
+extern const char* const connectedHeadsSource;
 extern const char* const vertexShaderSource;
+extern const char* const vertexShader300Source;
 }
 
 static inline const char**
@@ -33,13 +79,88 @@ getSourceMap()
     { GLProgramManager::ERODENONZEROROW, &erodeNonZeroRowSource },
     { GLProgramManager::ERODENONZEROCOLUMN, &erodeNonZeroColumnSource },
     { GLProgramManager::THRESHOLD, &thresholdSource },
+    { GLProgramManager::PACKGRAY, &packGraySource },
+    { GLProgramManager::PACKBINARY, &packBinarySource },
+    { GLProgramManager::SUBTRACT, &subtractSource },
+    { GLProgramManager::GAUSSIANROWPACKED, &gaussianFragRowPackedSource },
+    { GLProgramManager::GAUSSIANCOLUMNPACKED,
+      &gaussianFragColumnPackedSource },
+    { GLProgramManager::ADAPTIVETHRESHOLDPACKED,
+      &adaptiveThresholdPackedSource },
+    { GLProgramManager::DILATENONZEROROWPACKED,
+      &dilateNonZeroRowPackedSource },
+    { GLProgramManager::ERODENONZEROROWPACKED, &erodeNonZeroRowPackedSource },
+    { GLProgramManager::THRESHOLDPACKED, &thresholdPackedSource },
+    { GLProgramManager::SUBTRACTPACKED, &subtractPackedSource },
+    { GLProgramManager::UNPACKGRAY, &unpackGraySource },
+    { GLProgramManager::GAUSSIANROWLINEAR, &gaussianFragRowLinearSource },
+    { GLProgramManager::GAUSSIANCOLUMNLINEAR,
+      &gaussianFragColumnLinearSource },
+    { GLProgramManager::GAUSSIANCOLUMNPACKEDLINEAR,
+      &gaussianFragColumnPackedLinearSource },
+    { GLProgramManager::SUMMEDAREASEED, &summedAreaSeedSource },
+    { GLProgramManager::SUMMEDAREASEEDPACKED, &summedAreaSeedPackedSource },
+    { GLProgramManager::SUMMEDAREAROW, &summedAreaRowSource },
+    { GLProgramManager::SUMMEDAREACOLUMN, &summedAreaColumnSource },
+    { GLProgramManager::ADAPTIVEMEAN, &adaptiveMeanSource },
+    { GLProgramManager::ADAPTIVEMEANPACKED, &adaptiveMeanPackedSource },
+    { GLProgramManager::ADAPTIVEREDUCE, &adaptiveReduceSource },
+    { GLProgramManager::ADAPTIVEPYRAMID, &adaptivePyramidSource },
+    { GLProgramManager::LOCALDEVIATIONTHRESHOLD,
+      &localDeviationThresholdSource },
+    { GLProgramManager::MORPHOLOGYSCAN, &morphologyScanSource },
+    { GLProgramManager::MORPHOLOGYCOMBINE, &morphologyCombineSource },
+    { GLProgramManager::MORPHOLOGYDOUBLING, &morphologyDoublingSource },
+    { GLProgramManager::MORPHOLOGYMASK, &morphologyMaskSource },
+    { GLProgramManager::MORPHOLOGYMERGE, &morphologyMergeSource },
+    { GLProgramManager::HISTOGRAMSCATTER, &histogramScatterSource },
+    { GLProgramManager::HISTOGRAMREDUCE, &histogramReduceSource },
+    { GLProgramManager::OTSU, &otsuSource },
+    { GLProgramManager::OTSUTHRESHOLD, &otsuThresholdSource },
+    { GLProgramManager::CONNECTEDSTARTS, &connectedStartsSource },
+    { GLProgramManager::CONNECTEDGATHER, &connectedGatherSource },
+    { GLProgramManager::CONNECTEDPROPAGATE, &connectedPropagateSource },
+    { GLProgramManager::CONNECTEDHOOK, &connectedHookSource },
+    { GLProgramManager::CONNECTEDCHANGED, &connectedChangedSource },
+    { GLProgramManager::CONNECTEDSORT, &connectedSortSource },
+    { GLProgramManager::CONNECTEDSTATS, &connectedStatsSource },
+    { GLProgramManager::CONNECTEDREDUCE, &connectedReduceSource },
+    { GLProgramManager::CONNECTEDHEADS, &connectedHeadsSource },
   };
   return g_map;
 }
+
+// the programs not drawing the quad of the workflow.
+static SourceMap
+getVertexSourceMap()
+{
+  static SourceMap g_map = {
+    { GLProgramManager::MORPHOLOGYSCAN, &morphologyScanVertexSource },
+    { GLProgramManager::HISTOGRAMSCATTER, &histogramScatterVertexSource },
+    { GLProgramManager::CONNECTEDHOOK, &connectedHookVertexSource },
+  };
+  return g_map;
+}
+}
+
+// nothing but comments may precede a #version line.
+static std::string
+insertDefines(const char* source, const std::string& defines)
+{
+  std::string result(source);
+  size_t at = 0;
+  if (result.compare(0, 8, "#version") == 0) {
+    at = result.find('\n') + 1;
+  }
+  result.insert(at, defines);
+  return result;
 }
 
-GLProgramManager::GLProgramManager()
-  : m_vertexShader(0)
+GLProgramManager::GLProgramManager(
+  std::shared_ptr<GLShaderCache> shaderCache)
+  : m_shaderCache(std::move(shaderCache))
+  , m_vertexShader(0)
+  , m_vertexShader300(0)
 {
 }
 
@@ -49,7 +170,15 @@ GLProgramManager::~GLProgramManager()
   for (auto p : m_programs) {
     glDeleteProgram(p.second);
   }
-  glDeleteShader(m_vertexShader);
+  for (auto p : m_generatedPrograms) {
+    glDeleteProgram(p.second);
+  }
+  if (!m_shaderCache) {
+    glDeleteShader(m_vertexShader);
+    if (m_vertexShader300) {
+      glDeleteShader(m_vertexShader300);
+    }
+  }
 }
 
 static bool
@@ -131,17 +260,112 @@ GLProgramManager::getProgram(GLProgramManager::ProgramType programType)
   if (foundSource == sourceMap.end()) {
     return 0;
   }
-  GLuint fragShader = compileShaderSource(
-    GL_FRAGMENT_SHADER, 1, const_cast<const char**>(foundSource->second));
-  if (!fragShader) {
+  auto&& vertexSourceMap = getVertexSourceMap();
+  auto foundVertexSource = vertexSourceMap.find(programType);
+  GLuint program = buildProgram(*foundSource->second,
+                                foundVertexSource != vertexSourceMap.end()
+                                  ? *foundVertexSource->second
+                                  : nullptr);
+  if (!program) {
+    return 0;
+  }
+  m_programs.insert(std::make_pair(programType, program));
+  return program;
+}
+
+GLuint
+GLProgramManager::getProgram(GLProgramManager::ProgramType programType,
+                             const std::string& defines)
+{
+  auto&& sourceMap = getSourceMap();
+  auto foundSource = sourceMap.find(programType);
+  if (foundSource == sourceMap.end()) {
     return 0;
   }
-  GLuint program = createProgram(m_vertexShader, fragShader);
-  glDeleteShader(fragShader);
+  std::string source = insertDefines(*foundSource->second, defines);
+  auto&& vertexSourceMap = getVertexSourceMap();
+  auto foundVertexSource = vertexSourceMap.find(programType);
+  if (foundVertexSource == vertexSourceMap.end()) {
+    return getProgram(source);
+  }
+  std::string vertexSource =
+    insertDefines(*foundVertexSource->second, defines);
+  std::string key = source + vertexSource;
+  auto found = m_generatedPrograms.find(key);
+  if (found != m_generatedPrograms.end()) {
+    return found->second;
+  }
+  GLuint program = buildProgram(source.c_str(), vertexSource.c_str());
   if (!program) {
     return 0;
   }
-  m_programs.insert(std::make_pair(programType, program));
+  m_generatedPrograms.insert(std::make_pair(key, program));
+  return program;
+}
+
+GLuint
+GLProgramManager::getProgram(const std::string& fragSource)
+{
+  auto found = m_generatedPrograms.find(fragSource);
+  if (found != m_generatedPrograms.end()) {
+    return found->second;
+  }
+  GLuint program = buildProgram(fragSource.c_str());
+  if (!program) {
+    return 0;
+  }
+  m_generatedPrograms.insert(std::make_pair(fragSource, program));
+  return program;
+}
+
+GLuint
+GLProgramManager::vertexShaderFor(const char* fragSource)
+{
+  // glsl es 3.00 shaders only link with shaders of the same version.
+  static const char version300[] = "#version 300 es";
+  if (strncmp(fragSource, version300, sizeof(version300) - 1) != 0) {
+    return m_vertexShader;
+  }
+  if (!m_vertexShader300) {
+    const char* source = vertexShader300Source;
+    m_vertexShader300 =
+      m_shaderCache ? m_shaderCache->getShader(GL_VERTEX_SHADER, source)
+                    : compileShaderSource(GL_VERTEX_SHADER, 1, &source);
+  }
+  return m_vertexShader300;
+}
+
+GLuint
+GLProgramManager::buildProgram(const char* fragSource,
+                               const char* vertexSource)
+{
+  if (m_shaderCache) {
+    GLuint vertexShader =
+      vertexSource ? m_shaderCache->getShader(GL_VERTEX_SHADER, vertexSource)
+                   : vertexShaderFor(fragSource);
+    GLuint fragShader =
+      m_shaderCache->getShader(GL_FRAGMENT_SHADER, fragSource);
+    if (!vertexShader || !fragShader) {
+      return 0;
+    }
+    return createProgram(vertexShader, fragShader);
+  }
+  GLuint vertexShader =
+    vertexSource ? compileShaderSource(GL_VERTEX_SHADER, 1, &vertexSource)
+                 : vertexShaderFor(fragSource);
+  if (!vertexShader) {
+    return 0;
+  }
+  GLuint program = 0;
+  GLuint fragShader = compileShaderSource(GL_FRAGMENT_SHADER, 1, &fragSource);
+  if (fragShader) {
+    program = createProgram(vertexShader, fragShader);
+    glDeleteShader(fragShader);
+  }
+  // only the shared vertex shaders outlive the program.
+  if (vertexSource) {
+    glDeleteShader(vertexShader);
+  }
   return program;
 }
 
@@ -149,10 +373,39 @@ bool
 GLProgramManager::init()
 {
   GLuint vertexShader =
-    compileShaderSource(GL_VERTEX_SHADER, 1, getVertexSourceLocation());
+    m_shaderCache
+      ? m_shaderCache->getShader(GL_VERTEX_SHADER, vertexShaderSource)
+      : compileShaderSource(GL_VERTEX_SHADER, 1, getVertexSourceLocation());
   if (vertexShader == 0) {
     return false;
   }
   m_vertexShader = vertexShader;
   return true;
 }
+
+GLShaderCache::~GLShaderCache()
+{
+  CHECK_CONTEXT_NOT_NULL();
+  for (auto& p : m_shaders) {
+    glDeleteShader(p.second);
+  }
+}
+
+GLuint
+GLShaderCache::getShader(GLenum type, const char* source)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto key = std::make_pair(type, std::string(source));
+  auto found = m_shaders.find(key);
+  if (found != m_shaders.end()) {
+    return found->second;
+  }
+  GLuint shader = compileShaderSource(type, 1, &source);
+  if (!shader) {
+    return 0;
+  }
+  // other contexts of the group only see a finished compilation.
+  glFinish();
+  m_shaders.insert(std::make_pair(key, shader));
+  return shader;
+}
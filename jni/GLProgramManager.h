@@ -1,8 +1,28 @@
 #ifndef GLPROGRAMMANAGER_H
 #define GLPROGRAMMANAGER_H
 #include "GLCommon.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 
+// Shader objects compiled once for all the contexts of an EGL share
+// group. Programs are still linked per context: uniform values live in
+// the program object and would race between contexts drawing at the same
+// time. Must be destroyed with a context of the group current.
+class GLShaderCache final
+{
+public:
+  GLShaderCache() = default;
+  ~GLShaderCache();
+  GLuint getShader(GLenum type, const char* source);
+
+private:
+  std::mutex m_mutex;
+  std::map<std::pair<GLenum, std::string>, GLuint> m_shaders;
+};
+
 class GLProgramManager
 {
 public:
@@ -16,15 +36,89 @@ public:
     ERODENONZEROROW,
     ERODENONZEROCOLUMN,
     THRESHOLD,
+    PACKGRAY,
+    PACKBINARY,
+    SUBTRACT,
+    // variants on four pixels of the red channel per texel.
+    GAUSSIANROWPACKED,
+    GAUSSIANCOLUMNPACKED,
+    ADAPTIVETHRESHOLDPACKED,
+    DILATENONZEROROWPACKED,
+    ERODENONZEROROWPACKED,
+    THRESHOLDPACKED,
+    SUBTRACTPACKED,
+    UNPACKGRAY,
+    // gaussian passes fetching two taps at once.
+    GAUSSIANROWLINEAR,
+    GAUSSIANCOLUMNLINEAR,
+    GAUSSIANCOLUMNPACKEDLINEAR,
+    // gles3 only, summed-area tables in GL_R32UI or GL_RG32UI.
+    SUMMEDAREASEED,
+    SUMMEDAREASEEDPACKED,
+    SUMMEDAREAROW,
+    SUMMEDAREACOLUMN,
+    ADAPTIVEMEAN,
+    ADAPTIVEMEANPACKED,
+    // the gaussian mean at reduced resolution, REDUCTION and PACKED are
+    // defined by AdaptiveThresholdProcessor.
+    ADAPTIVEREDUCE,
+    ADAPTIVEPYRAMID,
+    // gles3 only, niblack and sauvola thresholds, SAUVOLA and PACKED are
+    // defined by SauvolaThresholdProcessor.
+    LOCALDEVIATIONTHRESHOLD,
+    // van Herk/Gil-Werman morphology, COMBINE is defined as max or min,
+    // MORPHOLOGYSCAN draws a quad per block with a vertex shader of its own.
+    MORPHOLOGYSCAN,
+    MORPHOLOGYCOMBINE,
+    // log-doubling morphology, COMBINE as above.
+    MORPHOLOGYDOUBLING,
+    // structuring elements, COMBINE as above.
+    MORPHOLOGYMASK,
+    MORPHOLOGYMERGE,
+    // global histogram and otsu threshold, HISTOGRAMSCATTER draws points
+    // with a vertex shader of its own.
+    HISTOGRAMSCATTER,
+    HISTOGRAMREDUCE,
+    OTSU,
+    OTSUTHRESHOLD,
+    // gles3 only, connected components, PACKED, EIGHT and TABLE are
+    // defined by ConnectedComponentsProcessor, CONNECTEDHOOK draws points
+    // with a vertex shader of its own.
+    CONNECTEDSTARTS,
+    CONNECTEDGATHER,
+    CONNECTEDPROPAGATE,
+    CONNECTEDHOOK,
+    CONNECTEDCHANGED,
+    CONNECTEDSORT,
+    CONNECTEDSTATS,
+    CONNECTEDREDUCE,
+    CONNECTEDHEADS,
   };
-  GLProgramManager();
+  // with a shader cache, shaders come from and stay in it.
+  explicit GLProgramManager(
+    std::shared_ptr<GLShaderCache> shaderCache = nullptr);
   ~GLProgramManager();
   bool init();
   GLuint getProgram(ProgramType programType);
+  // the program of a type compiled with the #define lines of defines in
+  // front of its sources, one program per distinct defines.
+  GLuint getProgram(ProgramType programType, const std::string& defines);
+  // programs generated at runtime, cached by their fragment source.
+  // sources starting with "#version 300 es" are linked with a vertex
+  // shader of that version.
+  GLuint getProgram(const std::string& fragSource);
 
 private:
+  // vertexSource replaces the vertex shader the fragment source implies.
+  GLuint buildProgram(const char* fragSource,
+                      const char* vertexSource = nullptr);
+  GLuint vertexShaderFor(const char* fragSource);
   std::unordered_map<GLuint, GLuint> m_programs;
+  std::unordered_map<std::string, GLuint> m_generatedPrograms;
+  std::shared_ptr<GLShaderCache> m_shaderCache;
   GLuint m_vertexShader;
+  // compiled on the first glsl es 3.00 program.
+  GLuint m_vertexShader300;
 };
 
 #endif /* GLPROGRAMMANAGER_H */
@@ -1,14 +1,94 @@
 #include "GLResources.h"
+#include <GLES3/gl3.h>
+#include <stdlib.h>
 
-GLTexture::GLTexture(GLuint id)
+GLTexture::GLTexture(GLuint id, GLuint framebuffer)
   : m_id(id)
+  , m_framebuffer(framebuffer)
 {
 }
 
 GLTexture::~GLTexture()
 {
+  if (m_framebuffer) {
+    CHECK_CONTEXT_NOT_NULL();
+    glDeleteFramebuffers(1, &m_framebuffer);
+  }
   if (m_id) {
     CHECK_CONTEXT_NOT_NULL();
     glDeleteTextures(1, &m_id);
   }
 }
+
+void
+allocateTexture(GLuint texture, GLint width, GLint height,
+                GLenum internalFormat, const void* data)
+{
+  GLenum format = internalFormat;
+  GLenum type = GL_UNSIGNED_BYTE;
+  if (internalFormat == GL_R32UI || internalFormat == GL_RG32UI ||
+      internalFormat == GL_RGBA32UI) {
+    // gles3 only, integer textures are never filtered.
+    format = internalFormat == GL_R32UI    ? GL_RED_INTEGER
+             : internalFormat == GL_RG32UI ? GL_RG_INTEGER
+                                           : GL_RGBA_INTEGER;
+    type = GL_UNSIGNED_INT;
+  } else if (internalFormat == GL_DEPTH_COMPONENT32F) {
+    format = GL_DEPTH_COMPONENT;
+    type = GL_FLOAT;
+  }
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format,
+               type, data);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+}
+
+void
+setTextureFilter(GLuint texture, GLenum filter)
+{
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+}
+
+size_t
+bytesPerPixel(GLenum internalFormat)
+{
+  switch (internalFormat) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RG32UI:
+      return 8;
+    case GL_RGBA32UI:
+      return 16;
+    default:
+      return 4;
+  }
+}
+
+GLuint
+createFramebuffer(GLuint texture)
+{
+  GLint previous = 0;
+  GLuint framebuffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture, 0);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    GLIMPROC_LOGE("fbo is not completed %d, %x.\n", __LINE__, status);
+    exit(1);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+  return framebuffer;
+}
@@ -1,15 +1,35 @@
 #ifndef GLRESOURCES_H
 #define GLRESOURCES_H
 #include "GLCommon.h"
+#include <stddef.h>
 
 class GLTexture
 {
 public:
-  explicit GLTexture(GLuint id);
+  explicit GLTexture(GLuint id, GLuint framebuffer = 0);
   virtual ~GLTexture();
   inline GLuint id() { return m_id; }
+  // a complete framebuffer with the texture attached, 0 if it has none.
+  inline GLuint framebuffer() { return m_framebuffer; }
 protected:
-  inline void reset() { m_id = 0; }
+  inline void reset()
+  {
+    m_id = 0;
+    m_framebuffer = 0;
+  }
   GLuint m_id;
+  GLuint m_framebuffer;
 };
+
+// define storage for texture with nearest filtering and mirrored wrapping.
+// internalFormat is an unsized format, or GL_R32UI, GL_RG32UI,
+// GL_RGBA32UI or GL_DEPTH_COMPONENT32F on gles3.
+void allocateTexture(GLuint texture, GLint width, GLint height,
+                     GLenum internalFormat, const void* data = nullptr);
+// switch the filtering of a texture allocated as above, it stays bound.
+void setTextureFilter(GLuint texture, GLenum filter);
+size_t bytesPerPixel(GLenum internalFormat);
+// a framebuffer with texture as its color attachment, checked for
+// completeness once. the framebuffer binding is left unchanged.
+GLuint createFramebuffer(GLuint texture);
 #endif /* GLRESOURCES_H */
@@ -0,0 +1,113 @@
+#include "GLTexturePool.h"
+#include "GLResources.h"
+
+class GLTexturePool::PooledTexture : public GLTexture
+{
+public:
+  PooledTexture(const Entry& entry, std::weak_ptr<GLTexturePool> pool);
+  ~PooledTexture();
+
+private:
+  Entry m_entry;
+  std::weak_ptr<GLTexturePool> m_pool;
+};
+
+GLTexturePool::GLTexturePool(size_t budget)
+  : m_budget(budget)
+  , m_allocatedBytes(0)
+{
+}
+
+GLTexturePool::~GLTexturePool()
+{
+  clear();
+}
+
+std::shared_ptr<GLTexture>
+GLTexturePool::acquire(GLint width, GLint height, GLenum internalFormat)
+{
+  for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+    if (it->width == width && it->height == height &&
+        it->internalFormat == internalFormat) {
+      Entry entry = *it;
+      m_idle.erase(it);
+      return std::shared_ptr<GLTexture>(
+        new PooledTexture(entry, shared_from_this()));
+    }
+  }
+  Entry entry = { width, height, internalFormat, 0, 0 };
+  // make room before allocating, so that the peak stays inside the budget
+  // whenever idle textures can cover it.
+  if (m_allocatedBytes + bytesOf(entry) > m_budget) {
+    evict(m_budget > bytesOf(entry) ? m_budget - bytesOf(entry) : 0);
+  }
+  CHECK_CONTEXT_NOT_NULL();
+  glGenTextures(1, &entry.texture);
+  allocateTexture(entry.texture, width, height, internalFormat);
+  entry.framebuffer = createFramebuffer(entry.texture);
+  m_allocatedBytes += bytesOf(entry);
+  return std::shared_ptr<GLTexture>(
+    new PooledTexture(entry, shared_from_this()));
+}
+
+void
+GLTexturePool::setBudget(size_t budget)
+{
+  m_budget = budget;
+  evict(m_budget);
+}
+
+void
+GLTexturePool::clear()
+{
+  evict(0);
+}
+
+void
+GLTexturePool::recycle(const Entry& entry)
+{
+  m_idle.push_front(entry);
+  evict(m_budget);
+}
+
+void
+GLTexturePool::evict(size_t budget)
+{
+  while (m_allocatedBytes > budget && !m_idle.empty()) {
+    release(m_idle.back());
+    m_idle.pop_back();
+  }
+}
+
+void
+GLTexturePool::release(const Entry& entry)
+{
+  CHECK_CONTEXT_NOT_NULL();
+  glDeleteFramebuffers(1, &entry.framebuffer);
+  glDeleteTextures(1, &entry.texture);
+  m_allocatedBytes -= bytesOf(entry);
+}
+
+size_t
+GLTexturePool::bytesOf(const Entry& entry)
+{
+  return static_cast<size_t>(entry.width) * entry.height *
+         bytesPerPixel(entry.internalFormat);
+}
+
+GLTexturePool::PooledTexture::PooledTexture(const Entry& entry,
+                                            std::weak_ptr<GLTexturePool> pool)
+  : GLTexture(entry.texture, entry.framebuffer)
+  , m_entry(entry)
+  , m_pool(pool)
+{
+}
+
+GLTexturePool::PooledTexture::~PooledTexture()
+{
+  std::shared_ptr<GLTexturePool> pool = m_pool.lock();
+  if (pool) {
+    pool->recycle(m_entry);
+    reset();
+  }
+}
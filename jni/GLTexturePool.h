@@ -0,0 +1,47 @@
+#ifndef GLTEXTUREPOOL_H
+#define GLTEXTUREPOOL_H
+#include "GLCommon.h"
+#include <list>
+#include <memory>
+#include <stddef.h>
+
+class GLTexture;
+
+// Keeps render target textures alive across frames, keyed on
+// (width, height, internal format). Released textures go to an idle list
+// in least recently used order and are evicted once the pool grows past
+// its memory budget. Every texture comes with its own framebuffer, built
+// and validated when the texture is allocated.
+class GLTexturePool final : public std::enable_shared_from_this<GLTexturePool>
+{
+public:
+  explicit GLTexturePool(size_t budget);
+  ~GLTexturePool();
+  std::shared_ptr<GLTexture> acquire(GLint width, GLint height,
+                                     GLenum internalFormat);
+  void setBudget(size_t budget);
+  inline size_t budget() const { return m_budget; }
+  void clear();
+  inline size_t allocatedBytes() const { return m_allocatedBytes; }
+  inline size_t idleCount() const { return m_idle.size(); }
+
+private:
+  class PooledTexture;
+  struct Entry
+  {
+    GLint width, height;
+    GLenum internalFormat;
+    GLuint texture;
+    GLuint framebuffer;
+  };
+  void recycle(const Entry& entry);
+  void evict(size_t budget);
+  void release(const Entry& entry);
+  static size_t bytesOf(const Entry& entry);
+  // most recently used at the front.
+  std::list<Entry> m_idle;
+  size_t m_budget;
+  size_t m_allocatedBytes;
+};
+
+#endif /* GLTEXTUREPOOL_H */
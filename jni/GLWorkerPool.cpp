@@ -0,0 +1,131 @@
+#include "GLWorkerPool.h"
+#include "GLProgramManager.h"
+#include "IImageProcessor.h"
+
+GLWorkerPool::GLWorkerPool(size_t queueCapacity)
+  : m_queue(queueCapacity)
+  , m_queued(0)
+  , m_pending(0)
+  , m_clientVersion(2)
+  , m_stopping(false)
+{
+}
+
+GLWorkerPool::~GLWorkerPool()
+{
+  wait();
+  shutdown();
+}
+
+bool
+GLWorkerPool::init(size_t workerCount, const Setup& setup,
+                   EGLint clientVersion)
+{
+  if (!m_root.init(clientVersion)) {
+    GLIMPROC_LOGE("fails to create the root context of the pool.\n");
+    return false;
+  }
+  m_clientVersion = clientVersion;
+  m_shaderCache = std::make_shared<GLShaderCache>();
+  std::vector<std::promise<bool>> ready(workerCount);
+  for (size_t i = 0; i < workerCount; ++i) {
+    m_workers.push_back(
+      std::thread(&GLWorkerPool::workerMain, this, setup, &ready[i]));
+  }
+  bool succeeded = true;
+  for (auto& r : ready) {
+    succeeded = r.get_future().get() && succeeded;
+  }
+  if (!succeeded) {
+    GLIMPROC_LOGE("fails to set up the workers of the pool.\n");
+    shutdown();
+  }
+  return succeeded;
+}
+
+void
+GLWorkerPool::submit(const ImageDesc& desc, Completion done)
+{
+  Job job = { desc, std::move(done) };
+  m_pending.fetch_add(1);
+  // counted first so that a sleeping worker never misses the job.
+  m_queued.fetch_add(1);
+  while (!m_queue.tryPush(std::move(job))) {
+    std::this_thread::yield();
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_wake.notify_one();
+}
+
+void
+GLWorkerPool::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+bool
+GLWorkerPool::nextJob(Job* job)
+{
+  for (;;) {
+    if (m_queue.tryPop(job)) {
+      m_queued.fetch_sub(1);
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake.wait(lock, [this] { return m_stopping || m_queued.load() != 0; });
+    if (m_stopping && m_queued.load() == 0) {
+      return false;
+    }
+  }
+}
+
+void
+GLWorkerPool::workerMain(Setup setup, std::promise<bool>* ready)
+{
+  GLContextManager context;
+  if (!context.init(m_clientVersion, &m_root)) {
+    GLIMPROC_LOGE("fails to create a worker context.\n");
+    ready->set_value(false);
+    return;
+  }
+  GLContextScope scope(context);
+  GLProgramManager pm(m_shaderCache);
+  ImageProcessorWorkflow wf;
+  std::vector<std::unique_ptr<IImageProcessor>> processors;
+  if (!pm.init() || !setup(&pm, &wf, &processors)) {
+    ready->set_value(false);
+    return;
+  }
+  ready->set_value(true);
+
+  Job job;
+  while (nextJob(&job)) {
+    ImageOutput output = wf.process(job.desc);
+    job.done(std::move(output));
+    job.done = nullptr;
+    if (m_pending.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_idle.notify_all();
+    }
+  }
+}
+
+void
+GLWorkerPool::shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_wake.notify_all();
+  }
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+  if (m_shaderCache) {
+    // the workers are gone, delete the shaders on the root context.
+    GLContextScope scope(m_root);
+    m_shaderCache.reset();
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef GLWORKERPOOL_H
+#define GLWORKERPOOL_H
+#include "GLContextManager.h"
+#include "ImageProcessorWorkflow.h"
+#include "LockFreeQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class GLProgramManager;
+class GLShaderCache;
+class IImageProcessor;
+
+// Worker threads, each with its own context in one EGL share group,
+// taking images from a lock-free queue. Every worker runs a workflow of
+// its own, built on its context by the setup function; shaders are
+// compiled once for the whole group.
+class GLWorkerPool final
+{
+public:
+  // builds the processors of one worker, registers them on wf and keeps
+  // them alive in processors. runs on the worker thread.
+  typedef std::function<bool(
+    GLProgramManager* pm, ImageProcessorWorkflow* wf,
+    std::vector<std::unique_ptr<IImageProcessor>>* processors)>
+    Setup;
+  // runs on the worker thread that processed the image.
+  typedef std::function<void(ImageOutput output)> Completion;
+
+  explicit GLWorkerPool(size_t queueCapacity = 256);
+  ~GLWorkerPool();
+  GLWorkerPool(const GLWorkerPool&) = delete;
+  GLWorkerPool& operator=(const GLWorkerPool&) = delete;
+  // eglInitialize must have been called on the default display.
+  bool init(size_t workerCount, const Setup& setup, EGLint clientVersion = 2);
+  // desc.data must stay valid until done has run. blocks while the queue
+  // is full.
+  void submit(const ImageDesc& desc, Completion done);
+  // blocks until every submitted image is done.
+  void wait();
+  inline size_t workerCount() const { return m_workers.size(); }
+
+private:
+  struct Job
+  {
+    ImageDesc desc;
+    Completion done;
+  };
+  void workerMain(Setup setup, std::promise<bool>* ready);
+  bool nextJob(Job* job);
+  void shutdown();
+  GLContextManager m_root;
+  std::shared_ptr<GLShaderCache> m_shaderCache;
+  LockFreeQueue<Job> m_queue;
+  std::vector<std::thread> m_workers;
+  // jobs pushed and not yet popped, and jobs not yet done.
+  std::atomic<size_t> m_queued;
+  std::atomic<size_t> m_pending;
+  // only for sleeping while there is nothing to do.
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  EGLint m_clientVersion;
+  bool m_stopping;
+};
+#endif /* GLWORKERPOOL_H */
@@ -0,0 +1,276 @@
+#include "GaussianBlurProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+
+GaussianBlurProcessor::GaussianBlurProcessor()
+  : m_blockSize(s_block_size)
+  , m_bilinearTaps(true)
+  , m_uTextureRow(0)
+  , m_uScreenGeometryRow(0)
+  , m_uKernelRow(0)
+  , m_programRow(0)
+  , m_uTextureColumn(0)
+  , m_uScreenGeometryColumn(0)
+  , m_uKernelColumn(0)
+  , m_programColumn(0)
+  , m_uTextureRowPacked(0)
+  , m_uScreenGeometryRowPacked(0)
+  , m_uImageWidthRowPacked(0)
+  , m_uKernelRowPacked(0)
+  , m_programRowPacked(0)
+  , m_uTextureColumnPacked(0)
+  , m_uScreenGeometryColumnPacked(0)
+  , m_uKernelColumnPacked(0)
+  , m_programColumnPacked(0)
+  , m_uTextureRowLinear(0)
+  , m_uScreenGeometryRowLinear(0)
+  , m_uTapsRowLinear(0)
+  , m_programRowLinear(0)
+  , m_uTextureColumnLinear(0)
+  , m_uScreenGeometryColumnLinear(0)
+  , m_uTapsColumnLinear(0)
+  , m_programColumnLinear(0)
+  , m_uTextureColumnPackedLinear(0)
+  , m_uScreenGeometryColumnPackedLinear(0)
+  , m_uTapsColumnPackedLinear(0)
+  , m_programColumnPackedLinear(0)
+{
+}
+
+void
+GaussianBlurProcessor::setBilinearTaps(bool enable)
+{
+  m_bilinearTaps = enable;
+}
+
+double
+GaussianBlurProcessor::getGaussianSigma(int n)
+{
+  return ((n - 1) * 0.5 - 1) * 0.3 + 0.8;
+}
+
+std::vector<GLfloat>
+GaussianBlurProcessor::getGaussianKernel(int n, double sigma)
+{
+  std::vector<GLfloat> kernel(n);
+  float* cf = const_cast<float*>(kernel.data());
+
+  double sigmaX = sigma > 0.0 ? sigma : getGaussianSigma(n);
+  double scale2X = -0.5 / (sigmaX * sigmaX);
+  double sum = 0;
+
+  int i;
+  for (i = 0; i < n; i++) {
+    double x = i - (n - 1) * 0.5;
+    double t = std::exp(scale2X * x * x);
+    {
+      cf[i] = (float)t;
+      sum += cf[i];
+    }
+  }
+
+  sum = 1. / sum;
+  for (i = 0; i < n; i++) {
+    cf[i] = (float)(cf[i] * sum);
+  }
+
+  return kernel;
+}
+
+std::vector<GLfloat>
+GaussianBlurProcessor::getBilinearTaps(int n, double sigma)
+{
+  std::vector<GLfloat> kernel = getGaussianKernel(n, sigma);
+  std::vector<GLfloat> taps;
+  double center = n * 0.5;
+  int left = n / 2;
+  for (int i = 0; i < left; i += 2) {
+    if (i + 1 == left) {
+      taps.push_back(static_cast<GLfloat>(center - (i + 0.5)));
+      taps.push_back(kernel[i]);
+      break;
+    }
+    double sum = static_cast<double>(kernel[i]) + kernel[i + 1];
+    // the sample point lies between the centers of taps i and i + 1,
+    // nearer to the heavier one.
+    double point = i + 0.5 + kernel[i + 1] / sum;
+    taps.push_back(static_cast<GLfloat>(center - point));
+    taps.push_back(static_cast<GLfloat>(sum));
+  }
+  if (n % 2) {
+    taps.push_back(0.0f);
+    taps.push_back(kernel[left] * 0.5f);
+  }
+  return taps;
+}
+
+bool
+GaussianBlurProcessor::init(GLProgramManager* pm, int blockSize,
+                            double sigma)
+{
+  if (blockSize < 1) {
+    GLIMPROC_LOGE("invalid block size %d.\n", blockSize);
+    return false;
+  }
+  m_blockSize = blockSize;
+  m_kernel = getGaussianKernel(blockSize, sigma);
+  m_kernel.resize((blockSize + 3) / 4 * 4, 0.0f);
+  m_taps = getBilinearTaps(blockSize, sigma);
+  // constant loop bounds, the compiler may unroll every loop.
+  char defines[64];
+  snprintf(defines, sizeof(defines),
+           "#define BLOCK_SIZE %d\n#define TAP_COUNT %d\n", blockSize,
+           static_cast<int>(m_taps.size() / 2));
+  m_programRow = pm->getProgram(GLProgramManager::GAUSSIANROW, defines);
+  m_programColumn = pm->getProgram(GLProgramManager::GAUSSIANCOLUMN, defines);
+  m_programRowPacked =
+    pm->getProgram(GLProgramManager::GAUSSIANROWPACKED, defines);
+  m_programColumnPacked =
+    pm->getProgram(GLProgramManager::GAUSSIANCOLUMNPACKED, defines);
+  m_programRowLinear =
+    pm->getProgram(GLProgramManager::GAUSSIANROWLINEAR, defines);
+  m_programColumnLinear =
+    pm->getProgram(GLProgramManager::GAUSSIANCOLUMNLINEAR, defines);
+  m_programColumnPackedLinear =
+    pm->getProgram(GLProgramManager::GAUSSIANCOLUMNPACKEDLINEAR, defines);
+  if (!m_programRow || !m_programColumn || !m_programRowPacked ||
+      !m_programColumnPacked || !m_programRowLinear ||
+      !m_programColumnLinear || !m_programColumnPackedLinear) {
+    return false;
+  }
+  GLint program = m_programRow;
+  m_uTextureRow = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryRow = glGetUniformLocation(program, "u_screenGeometry");
+  m_uKernelRow = glGetUniformLocation(program, "u_kernel");
+
+  program = m_programColumn;
+  m_uTextureColumn = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryColumn = glGetUniformLocation(program, "u_screenGeometry");
+  m_uKernelColumn = glGetUniformLocation(program, "u_kernel");
+
+  program = m_programRowPacked;
+  m_uTextureRowPacked = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryRowPacked =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uImageWidthRowPacked = glGetUniformLocation(program, "u_imageWidth");
+  m_uKernelRowPacked = glGetUniformLocation(program, "u_kernel");
+
+  program = m_programColumnPacked;
+  m_uTextureColumnPacked = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryColumnPacked =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uKernelColumnPacked = glGetUniformLocation(program, "u_kernel");
+
+  program = m_programRowLinear;
+  m_uTextureRowLinear = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryRowLinear =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uTapsRowLinear = glGetUniformLocation(program, "u_taps");
+
+  program = m_programColumnLinear;
+  m_uTextureColumnLinear = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryColumnLinear =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uTapsColumnLinear = glGetUniformLocation(program, "u_taps");
+
+  program = m_programColumnPackedLinear;
+  m_uTextureColumnPackedLinear = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryColumnPackedLinear =
+    glGetUniformLocation(program, "u_screenGeometry");
+  m_uTapsColumnPackedLinear = glGetUniformLocation(program, "u_taps");
+  return checkError("GaussianBlurProcessor::init");
+}
+
+ProcessorFootprint
+GaussianBlurProcessor::footprint() const
+{
+  GLint half = m_blockSize / 2;
+  GLint rest = m_blockSize - 1 - half;
+  return ProcessorFootprint{ half, rest, rest, half };
+}
+
+ProcessorOutput
+GaussianBlurProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  // zero for row blur, one for column blur
+  std::shared_ptr<GLTexture> tmpTexture[2] = {
+    wf->requestTextureForFramebuffer(pin.width, pin.height, GL_RGBA),
+    wf->requestTextureForFramebuffer(pin.width, pin.height, GL_RGBA)
+  };
+
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  GLsizei tapCount = static_cast<GLsizei>(m_taps.size() / 2);
+  GLsizei kernelCount = static_cast<GLsizei>(m_kernel.size() / 4);
+  if (pin.packed) {
+    glUseProgram(m_programRowPacked);
+    glUniform1i(m_uTextureRowPacked, 0);
+    glUniform2iv(m_uScreenGeometryRowPacked, 1, imageGeometry);
+    glUniform1f(m_uImageWidthRowPacked, static_cast<GLfloat>(pin.pixelWidth));
+    glUniform4fv(m_uKernelRowPacked, kernelCount, m_kernel.data());
+  } else if (m_bilinearTaps) {
+    glUseProgram(m_programRowLinear);
+    glUniform1i(m_uTextureRowLinear, 0);
+    glUniform2iv(m_uScreenGeometryRowLinear, 1, imageGeometry);
+    glUniform2fv(m_uTapsRowLinear, tapCount, m_taps.data());
+    setTextureFilter(pin.color->id(), GL_LINEAR);
+  } else {
+    glUseProgram(m_programRow);
+    glUniform1i(m_uTextureRow, 0);
+
+    glUniform2iv(m_uScreenGeometryRow, 1, imageGeometry);
+    glUniform4fv(m_uKernelRow, kernelCount, m_kernel.data());
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  if (m_bilinearTaps && !pin.packed) {
+    setTextureFilter(pin.color->id(), GL_NEAREST);
+  }
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[1].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tmpTexture[0]->id());
+  if (m_bilinearTaps) {
+    if (pin.packed) {
+      glUseProgram(m_programColumnPackedLinear);
+      glUniform1i(m_uTextureColumnPackedLinear, 0);
+      glUniform2iv(m_uScreenGeometryColumnPackedLinear, 1, imageGeometry);
+      glUniform2fv(m_uTapsColumnPackedLinear, tapCount, m_taps.data());
+    } else {
+      glUseProgram(m_programColumnLinear);
+      glUniform1i(m_uTextureColumnLinear, 0);
+      glUniform2iv(m_uScreenGeometryColumnLinear, 1, imageGeometry);
+      glUniform2fv(m_uTapsColumnLinear, tapCount, m_taps.data());
+    }
+    setTextureFilter(tmpTexture[0]->id(), GL_LINEAR);
+  } else if (pin.packed) {
+    glUseProgram(m_programColumnPacked);
+    glUniform1i(m_uTextureColumnPacked, 0);
+    glUniform2iv(m_uScreenGeometryColumnPacked, 1, imageGeometry);
+    glUniform4fv(m_uKernelColumnPacked, kernelCount, m_kernel.data());
+  } else {
+    glUseProgram(m_programColumn);
+    glUniform1i(m_uTextureColumn, 0);
+
+    glUniform2iv(m_uScreenGeometryColumn, 1, imageGeometry);
+    glUniform4fv(m_uKernelColumn, kernelCount, m_kernel.data());
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  if (m_bilinearTaps) {
+    setTextureFilter(tmpTexture[0]->id(), GL_NEAREST);
+  }
+  return ProcessorOutput{ tmpTexture[1] };
+}
@@ -0,0 +1,85 @@
+#ifndef GAUSSIANBLURPROCESSOR_H
+#define GAUSSIANBLURPROCESSOR_H
+#include "IImageProcessor.h"
+#include <vector>
+
+class GLProgramManager;
+
+// The separable gaussian blur of AdaptiveThresholdProcessor as a node of
+// its own, so that a processor graph can share one blur between several
+// consumers.
+class GaussianBlurProcessor final : public IImageProcessor
+{
+public:
+  GaussianBlurProcessor();
+  ~GaussianBlurProcessor() = default;
+  // blockSize taps per direction, the shaders are compiled for it. sigma
+  // as in cv::getGaussianKernel, derived from blockSize unless positive.
+  bool init(GLProgramManager* pm, int blockSize = s_block_size,
+            double sigma = 0.0);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  bool supportsPackedLuma() const override { return true; }
+  // fetch neighbouring taps in pairs through linear filtering, on by
+  // default. off samples every tap, results differ by at most one LSB.
+  // the row pass on packed luma always samples every tap.
+  void setBilinearTaps(bool enable);
+  // normalized gaussian weights of n taps, sigma as chosen by opencv
+  // unless positive.
+  static std::vector<GLfloat> getGaussianKernel(int n, double sigma = 0.0);
+  // the sigma opencv chooses for n taps.
+  static double getGaussianSigma(int n);
+  // the n taps merged into pairs read by one linear fetch. the kernel is
+  // symmetric, so only the pairs left of its center are kept: each as the
+  // distance of its sample point from the center and the sum of its two
+  // weights, the pair as far right of the center has the same values. a
+  // tap left without partner is kept alone, the middle tap of an odd n
+  // as two halves at distance zero.
+  static std::vector<GLfloat> getBilinearTaps(int n, double sigma = 0.0);
+  // the default block size.
+  static const GLint s_block_size = 92;
+
+private:
+  GLint m_blockSize;
+  // padded with zeros to whole vec4s.
+  std::vector<GLfloat> m_kernel;
+  std::vector<GLfloat> m_taps;
+  bool m_bilinearTaps;
+
+  GLint m_uTextureRow;
+  GLint m_uScreenGeometryRow;
+  GLint m_uKernelRow;
+  GLint m_programRow;
+
+  GLint m_uTextureColumn;
+  GLint m_uScreenGeometryColumn;
+  GLint m_uKernelColumn;
+  GLint m_programColumn;
+
+  GLint m_uTextureRowPacked;
+  GLint m_uScreenGeometryRowPacked;
+  GLint m_uImageWidthRowPacked;
+  GLint m_uKernelRowPacked;
+  GLint m_programRowPacked;
+
+  GLint m_uTextureColumnPacked;
+  GLint m_uScreenGeometryColumnPacked;
+  GLint m_uKernelColumnPacked;
+  GLint m_programColumnPacked;
+
+  GLint m_uTextureRowLinear;
+  GLint m_uScreenGeometryRowLinear;
+  GLint m_uTapsRowLinear;
+  GLint m_programRowLinear;
+
+  GLint m_uTextureColumnLinear;
+  GLint m_uScreenGeometryColumnLinear;
+  GLint m_uTapsColumnLinear;
+  GLint m_programColumnLinear;
+
+  GLint m_uTextureColumnPackedLinear;
+  GLint m_uScreenGeometryColumnPackedLinear;
+  GLint m_uTapsColumnPackedLinear;
+  GLint m_programColumnPackedLinear;
+};
+#endif /* GAUSSIANBLURPROCESSOR_H */
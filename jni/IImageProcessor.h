@@ -3,20 +3,66 @@
 #include "GLCommon.h"
 #include <memory>
 #include <stdint.h>
+#include <vector>
 
 class GLTexture;
 class ImageProcessorWorkflow;
 
 struct ProcessorOutput
 {
+  // null when the processor failed, with a log. the workflow then returns
+  // no output for the image.
   std::shared_ptr<GLTexture> color;
 };
 
+// What a processor computes, for planning across processor boundaries.
+struct ProcessorDescription
+{
+  enum Kind
+  {
+    THRESHOLD,
+    DILATE_NONZERO,
+    ERODE_NONZERO,
+  };
+  Kind kind;
+  // THRESHOLD: output is maxValue where input.r > threshold, else zero.
+  // input is sampled at (offsetX, offsetY) relative to the output pixel.
+  int maxValue, threshold;
+  GLint offsetX, offsetY;
+  // DILATE_NONZERO/ERODE_NONZERO: separable rectangular kernel.
+  unsigned kwidth, kheight;
+};
+
+// Input pixels a processor reads beyond each output pixel, per side.
+struct ProcessorFootprint
+{
+  GLint left, right, bottom, top;
+};
+
+// the footprint, per side, of processors that read the whole image, such
+// as global thresholds. wider than any texture, so that images are never
+// tiled and regions of interest render every pixel before them.
+static const GLint s_wholeImageFootprint = 1 << 20;
+
+// Pixels the scratch textures of a processor span beyond its input along
+// each axis.
+struct ProcessorExtent
+{
+  GLint width, height;
+};
+
 struct ProcessorInput
 {
   GLint width, height;
   std::shared_ptr<GLTexture> color;
   ImageProcessorWorkflow* wf;
+  // every input of a graph node in order, color is the first one.
+  std::vector<std::shared_ptr<GLTexture>> inputs;
+  // the textures hold the red channel of four consecutive pixels per
+  // texel, see ImageProcessorWorkflow::setPackedLuma. width counts texels
+  // then, pixelWidth the pixels of a row.
+  bool packed;
+  GLint pixelWidth;
 };
 
 class IImageProcessor
@@ -24,6 +70,21 @@ class IImageProcessor
 public:
   virtual ~IImageProcessor() = default;
   virtual ProcessorOutput process(const ProcessorInput& desc) = 0;
+  // processors that can not be described are never fused with others.
+  virtual bool describe(ProcessorDescription* desc) const { return false; }
+  // used to size the halo of tiles and regions of interest.
+  virtual ProcessorFootprint footprint() const
+  {
+    return ProcessorFootprint{ 0, 0, 0, 0 };
+  }
+  // reserved by tiles next to the footprints, so that the scratch
+  // textures of process() still fit in GL_MAX_TEXTURE_SIZE.
+  virtual ProcessorExtent scratchExtent() const
+  {
+    return ProcessorExtent{ 0, 0 };
+  }
+  // whether process() understands ProcessorInput::packed.
+  virtual bool supportsPackedLuma() const { return false; }
 };
 
 #endif /* IIMAGEPROCESSOR_H */
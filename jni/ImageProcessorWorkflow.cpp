@@ -1,29 +1,66 @@
 #include "ImageProcessorWorkflow.h"
+#include "FrameTexturePlan.h"
+#include "FusedPassProcessor.h"
 #include "GLResources.h"
+#include "GLTexturePool.h"
 #include "IImageProcessor.h"
+#include "InputTexture.h"
+#include "PackProcessor.h"
+#include "PassFusionPlanner.h"
+#include "PipelineOptimizer.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-static const int s_preallocateTextureCount = 3;
+static const size_t s_defaultTexturePoolBudget = 64 * 1024 * 1024;
+// frame N is read back while frame N + 1 renders.
+static const size_t s_readbackRingSize = 2;
+// tiles start on whole bytes of the packed output formats.
+static const GLint s_tileAlignment = 32;
 
-namespace {
-class GLRebornTexture : public GLTexture
+static GLint
+alignTile(GLint value)
 {
-public:
-  GLRebornTexture(GLuint id, ImageProcessorWorkflow* wf);
-  ~GLRebornTexture();
+  return (value + s_tileAlignment - 1) / s_tileAlignment * s_tileAlignment;
+}
 
-private:
-  ImageProcessorWorkflow* m_wf;
-};
+static void
+scissorAround(const ImageRegion& region, const ProcessorFootprint& f,
+              GLint width, GLint height, GLint pixelsPerTexel)
+{
+  GLint x0 = std::max(0, region.x - f.left);
+  GLint y0 = std::max(0, region.y - f.bottom);
+  GLint x1 = std::min(width, region.x + region.width + f.right);
+  GLint y1 = std::min(height, region.y + region.height + f.top);
+  // every texel holding one of the pixels.
+  x0 /= pixelsPerTexel;
+  x1 = (x1 + pixelsPerTexel - 1) / pixelsPerTexel;
+  glScissor(x0, y0, x1 - x0, y1 - y0);
 }
 
 ImageProcessorWorkflow::ImageProcessorWorkflow()
-  : m_fbo(0)
+  : m_graph(nullptr)
+  , m_outputSlot(0)
+  , m_footprint{ 0, 0, 0, 0 }
+  , m_scratchExtent{ 0, 0 }
+  , m_activeTexturePlan(nullptr)
+  , m_fbo(0)
   , m_width(0)
   , m_height(0)
   , m_vbo(0)
-  , m_staled(false)
+  , m_outputFormat(OUTPUT_RGBA)
+  , m_tileSize(0)
+  , m_programManager(nullptr)
+  , m_fusePasses(false)
+  , m_optimizePipeline(false)
+  , m_planned(false)
+  , m_packedLuma(false)
+  , m_runPacked(false)
 {
   CHECK_CONTEXT_NOT_NULL();
+  m_texturePool.reset(new GLTexturePool(s_defaultTexturePoolBudget));
+  m_inputTexture.reset(new InputTexture);
   glGenFramebuffers(1, &m_fbo);
   glGenBuffers(1, &m_vbo);
   static float positions[][4] = {
@@ -38,7 +75,6 @@ ImageProcessorWorkflow::ImageProcessorWorkflow()
 
 ImageProcessorWorkflow::~ImageProcessorWorkflow()
 {
-  m_staled = true;
   CHECK_CONTEXT_NOT_NULL();
   glDeleteFramebuffers(1, &m_fbo);
   glDeleteBuffers(1, &m_vbo);
@@ -48,50 +84,576 @@ void
 ImageProcessorWorkflow::registerIImageProcessor(IImageProcessor* processor)
 {
   m_processors.push_back(processor);
+  m_planned = false;
+}
+
+void
+ImageProcessorWorkflow::enablePassFusion(GLProgramManager* pm)
+{
+  m_programManager = pm;
+  m_fusePasses = true;
+  m_planned = false;
+}
+
+void
+ImageProcessorWorkflow::enablePipelineOptimization(GLProgramManager* pm)
+{
+  m_programManager = pm;
+  m_optimizePipeline = true;
+  m_planned = false;
+}
+
+void
+ImageProcessorWorkflow::setProcessorGraph(ProcessorGraph* graph)
+{
+  m_graph = graph;
+  m_planned = false;
+}
+
+void
+ImageProcessorWorkflow::setInputUnpackBuffers(size_t count)
+{
+  m_inputTexture->setUnpackBufferCount(count);
+}
+
+bool
+ImageProcessorWorkflow::setPackedLuma(bool enable, GLProgramManager* pm)
+{
+  m_lumaPacker.reset();
+  m_lumaUnpacker.reset();
+  m_packedLuma = false;
+  m_planned = false;
+  if (!enable) {
+    return true;
+  }
+  std::unique_ptr<PackProcessor> packer(new PackProcessor);
+  std::unique_ptr<PackProcessor> unpacker(new PackProcessor);
+  if (!packer->init(pm, PackProcessor::PACK_GRAY) ||
+      !unpacker->init(pm, PackProcessor::UNPACK_GRAY)) {
+    return false;
+  }
+  m_lumaPacker = std::move(packer);
+  m_lumaUnpacker = std::move(unpacker);
+  m_packedLuma = true;
+  return true;
+}
+
+void
+ImageProcessorWorkflow::planProcessors()
+{
+  // fused passes have no packed variant: plan packed without fusing, and
+  // plan again unpacked when a scheduled step has no packed variant.
+  m_runPacked = m_packedLuma;
+  scheduleSteps();
+  if (m_runPacked &&
+      std::any_of(m_steps.begin(), m_steps.end(), [](const ProcessorStep& step) {
+        return !step.processor->supportsPackedLuma();
+      })) {
+    GLIMPROC_LOGE("a processor has no packed variant, running unpacked.\n");
+    m_runPacked = false;
+    scheduleSteps();
+  }
+  m_planned = true;
+  m_texturePlans.clear();
+  m_scratchExtent = ProcessorExtent{ 0, 0 };
+  for (auto& step : m_steps) {
+    ProcessorExtent e = step.processor->scratchExtent();
+    m_scratchExtent.width = std::max(m_scratchExtent.width, e.width);
+    m_scratchExtent.height = std::max(m_scratchExtent.height, e.height);
+  }
+}
+
+void
+ImageProcessorWorkflow::scheduleSteps()
+{
+  planChain();
+  ProcessorGraph chain;
+  ProcessorGraph* graph = m_graph;
+  if (!graph) {
+    std::string previous = ProcessorGraph::s_source;
+    for (size_t i = 0; i < m_plan.size(); ++i) {
+      // gnustl has no std::to_string.
+      char image[32];
+      snprintf(image, sizeof(image), "%u", static_cast<unsigned>(i));
+      chain.addNode(m_plan[i], { previous }, image);
+      previous = image;
+    }
+    chain.setOutput(previous);
+    graph = &chain;
+  }
+  if (!graph->schedule(&m_steps, &m_outputSlot, &m_footprint)) {
+    GLIMPROC_LOGE("fails to schedule the graph, passing the image through.\n");
+    m_steps.clear();
+    m_outputSlot = 0;
+    m_footprint = ProcessorFootprint{ 0, 0, 0, 0 };
+  }
+}
+
+void
+ImageProcessorWorkflow::planChain()
+{
+  m_plan.clear();
+  m_plannedProcessors.clear();
+  if (m_graph || (!m_fusePasses && !m_optimizePipeline)) {
+    m_plan = m_processors;
+    return;
+  }
+  size_t begin = 0;
+  while (begin < m_processors.size()) {
+    // plan the longest run of described processors starting at begin.
+    std::vector<ProcessorDescription> descs;
+    ProcessorDescription desc;
+    size_t end = begin;
+    while (end < m_processors.size() && m_processors[end]->describe(&desc)) {
+      descs.push_back(desc);
+      ++end;
+    }
+    if (descs.empty()) {
+      m_plan.push_back(m_processors[begin++]);
+      continue;
+    }
+    if (!planRun(descs)) {
+      GLIMPROC_LOGE("fails to plan processors, running them as is.\n");
+      m_plan.insert(m_plan.end(), m_processors.begin() + begin,
+                    m_processors.begin() + end);
+    }
+    begin = end;
+  }
+}
+
+bool
+ImageProcessorWorkflow::planRun(std::vector<ProcessorDescription> descs)
+{
+  std::vector<std::unique_ptr<IImageProcessor>> planned;
+  if (m_optimizePipeline) {
+    unsigned before = PassFusionPlanner::unfusedPassCount(descs);
+    descs = PipelineOptimizer().optimize(descs);
+    unsigned after = PassFusionPlanner::unfusedPassCount(descs);
+    GLIMPROC_LOGI("pipeline optimizer saved %u of %u passes.\n",
+                  before - after, before);
+  }
+  if (m_fusePasses && !m_runPacked) {
+    std::vector<FusedPass> passes = PassFusionPlanner().plan(descs);
+    GLIMPROC_LOGI("fused %u passes into %zu.\n",
+                  PassFusionPlanner::unfusedPassCount(descs), passes.size());
+    PassFusionPlanner::dump(passes);
+    for (auto& pass : passes) {
+      std::unique_ptr<FusedPassProcessor> processor(new FusedPassProcessor);
+      if (!processor->init(m_programManager, pass)) {
+        return false;
+      }
+      planned.push_back(std::move(processor));
+    }
+  } else {
+    for (auto& desc : descs) {
+      std::unique_ptr<IImageProcessor> processor =
+        PipelineOptimizer::createProcessor(m_programManager, desc);
+      if (!processor) {
+        return false;
+      }
+      planned.push_back(std::move(processor));
+    }
+  }
+  for (auto& processor : planned) {
+    m_plan.push_back(processor.get());
+    m_plannedProcessors.push_back(std::move(processor));
+  }
+  return true;
+}
+
+void
+ImageProcessorWorkflow::setTileSize(GLint tileSize)
+{
+  m_tileSize = tileSize;
 }
 
 ImageOutput
 ImageProcessorWorkflow::process(const ImageDesc& desc)
 {
-  m_width = desc.width;
-  m_height = desc.height;
-  GLuint texture;
+  bool tiled;
+  GLint tileWidth, tileHeight;
+  if (!tileGeometry(desc, &tiled, &tileWidth, &tileHeight)) {
+    return ImageOutput{ nullptr, m_outputFormat, 0 };
+  }
+  if (m_outputFormat == OUTPUT_NONE) {
+    render(desc);
+    return ImageOutput{ nullptr, OUTPUT_NONE, 0 };
+  }
+  if (tiled) {
+    return processTiled(desc, tileWidth, tileHeight);
+  }
+  std::shared_ptr<GLTexture> output = render(desc);
+  if (!output) {
+    return ImageOutput{ nullptr, m_outputFormat, 0 };
+  }
+  FBOScope fboscope(this);
+  bindRenderTarget(output.get());
 
-  CHECK_CONTEXT_NOT_NULL();
-  glGenTextures(1, &texture);
-  allocateTexture(texture, m_width, m_height, desc.format, desc.data);
-  std::shared_ptr<GLTexture> scope(new GLTexture(texture));
+  GLint width = readbackWidth(desc.width);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  std::unique_ptr<uint8_t[]> readback(new uint8_t[width * desc.height * 4]);
+  glReadPixels(0, 0, width, desc.height, GL_RGBA, GL_UNSIGNED_BYTE,
+               readback.get());
+  return ImageOutput{ std::move(readback), m_outputFormat, width * 4 };
+}
+
+ImageOutput
+ImageProcessorWorkflow::process(const ImageDesc& desc,
+                                const std::vector<ImageRegion>& regions)
+{
+  if (m_outputFormat == OUTPUT_NONE) {
+    return process(desc);
+  }
+  bool tiled;
+  GLint tileWidth, tileHeight;
+  if (!tileGeometry(desc, &tiled, &tileWidth, &tileHeight)) {
+    return ImageOutput{ nullptr, m_outputFormat, 0 };
+  }
+  GLint stride = readbackWidth(desc.width) * 4;
+  std::unique_ptr<uint8_t[]> readback(new uint8_t[stride * desc.height]());
+  std::shared_ptr<GLTexture> input;
+  if (!tiled) {
+    input = uploadInput(desc);
+  }
+  for (auto& r : regions) {
+    ImageRegion region;
+    if (!clipRegion(r, desc, &region)) {
+      continue;
+    }
+    if (tiled) {
+      if (!processTiles(desc, region, tileWidth, tileHeight, readback.get(),
+                        stride)) {
+        return ImageOutput{ nullptr, m_outputFormat, 0 };
+      }
+      continue;
+    }
+    std::shared_ptr<GLTexture> output =
+      render(input, desc.width, desc.height, &region);
+    if (!output) {
+      return ImageOutput{ nullptr, m_outputFormat, 0 };
+    }
+    FBOScope fboscope(this);
+    bindRenderTarget(output.get());
+    readRegion(region.x, region.y, region, readback.get(), stride);
+  }
+  return ImageOutput{ std::move(readback), m_outputFormat, stride };
+}
+
+bool
+ImageProcessorWorkflow::clipRegion(const ImageRegion& region,
+                                   const ImageDesc& desc,
+                                   ImageRegion* clipped) const
+{
+  GLint ppt = pixelsPerTexel();
+  GLint x0 = std::max(0, region.x) / ppt * ppt;
+  GLint y0 = std::max(0, region.y);
+  GLint x1 = region.x + region.width;
+  x1 = std::min(desc.width, (x1 + ppt - 1) / ppt * ppt);
+  GLint y1 = std::min(desc.height, region.y + region.height);
+  if (x0 >= x1 || y0 >= y1) {
+    return false;
+  }
+  *clipped = ImageRegion{ x0, y0, x1 - x0, y1 - y0 };
+  return true;
+}
+
+// gles2 has no GL_PACK_ROW_LENGTH, the rows are read into a scratch buffer
+// and copied into place.
+void
+ImageProcessorWorkflow::readRegion(GLint x, GLint y, const ImageRegion& dst,
+                                   uint8_t* readback, GLint stride)
+{
+  GLint texels = readbackWidth(dst.width);
+  size_t rowBytes = texels * 4;
+  std::vector<uint8_t> rows(rowBytes * dst.height);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(readbackWidth(x), y, texels, dst.height, GL_RGBA,
+               GL_UNSIGNED_BYTE, rows.data());
+  for (GLint row = 0; row < dst.height; ++row) {
+    memcpy(readback + (dst.y + row) * stride + readbackWidth(dst.x) * 4,
+           &rows[row * rowBytes], rowBytes);
+  }
+}
+
+ImageOutputFuture
+ImageProcessorWorkflow::processAsync(const ImageDesc& desc)
+{
+  bool tiled;
+  GLint tileWidth, tileHeight;
+  if (!tileGeometry(desc, &tiled, &tileWidth, &tileHeight)) {
+    return ImageOutputFuture();
+  }
+  if (!isGLES3Context() || m_outputFormat == OUTPUT_NONE || tiled) {
+    ImageOutput output = process(desc);
+    return ImageOutputFuture(std::move(output.outputBytes), output.stride);
+  }
+  std::shared_ptr<GLTexture> output = render(desc);
+  if (!output) {
+    return ImageOutputFuture();
+  }
+  FBOScope fboscope(this);
+  bindRenderTarget(output.get());
+  if (!m_readbackRing) {
+    m_readbackRing.reset(new ReadbackRing(s_readbackRingSize));
+  }
+  return m_readbackRing->readPixels(readbackWidth(desc.width), desc.height);
+}
+
+ProcessorFootprint
+ImageProcessorWorkflow::planFootprint() const
+{
+  return m_footprint;
+}
+
+bool
+ImageProcessorWorkflow::tileGeometry(const ImageDesc& desc, bool* tiled,
+                                     GLint* tileWidth, GLint* tileHeight)
+{
+  if (!m_planned) {
+    planProcessors();
+  }
+  // the scratch textures of the steps grow past the image.
+  GLint maxSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  GLint maxWidth = maxSize - m_scratchExtent.width;
+  GLint maxHeight = maxSize - m_scratchExtent.height;
+  ProcessorFootprint f = planFootprint();
+  bool wholeImage = f.left >= s_wholeImageFootprint;
+  *tiled = false;
+  if ((m_tileSize <= 0 || wholeImage) && desc.width <= maxWidth &&
+      desc.height <= maxHeight) {
+    return true;
+  }
+  if (wholeImage) {
+    GLIMPROC_LOGE("a processor reads the whole image, which exceeds the "
+                  "texture size.\n");
+    return false;
+  }
+  // the largest core whose tile, halo included, still fits in a texture.
+  *tileWidth = (maxWidth - alignTile(f.left) - f.right) / s_tileAlignment *
+               s_tileAlignment;
+  *tileHeight = maxHeight - f.bottom - f.top;
+  if (m_tileSize > 0) {
+    *tileWidth = std::min(*tileWidth, alignTile(m_tileSize));
+    *tileHeight = std::min(*tileHeight, m_tileSize);
+  }
+  if (*tileWidth <= 0 || *tileHeight <= 0) {
+    GLIMPROC_LOGE("footprint of the processors exceeds the texture size.\n");
+    return false;
+  }
+  *tiled = desc.width > *tileWidth || desc.height > *tileHeight;
+  return true;
+}
+
+ImageOutput
+ImageProcessorWorkflow::processTiled(const ImageDesc& desc, GLint tileWidth,
+                                     GLint tileHeight)
+{
+  GLint stride = readbackWidth(desc.width) * 4;
+  std::unique_ptr<uint8_t[]> readback(new uint8_t[stride * desc.height]);
+  ImageRegion whole = { 0, 0, desc.width, desc.height };
+  if (!processTiles(desc, whole, tileWidth, tileHeight, readback.get(),
+                    stride)) {
+    return ImageOutput{ nullptr, m_outputFormat, 0 };
+  }
+  return ImageOutput{ std::move(readback), m_outputFormat, stride };
+}
+
+bool
+ImageProcessorWorkflow::processTiles(const ImageDesc& desc,
+                                     const ImageRegion& region,
+                                     GLint tileWidth, GLint tileHeight,
+                                     uint8_t* readback, GLint stride)
+{
+  ProcessorFootprint f = planFootprint();
+  GLint left = alignTile(f.left);
+  size_t bpp = bytesPerPixel(desc.format);
+  const uint8_t* src = static_cast<const uint8_t*>(desc.data);
+  GLint regionRight = region.x + region.width;
+  GLint regionTop = region.y + region.height;
+  std::vector<uint8_t> staging;
+
+  for (GLint y = region.y; y < regionTop; y += tileHeight) {
+    for (GLint x = region.x; x < regionRight; x += tileWidth) {
+      ImageRegion core = { x, y, std::min(tileWidth, regionRight - x),
+                           std::min(tileHeight, regionTop - y) };
+      // tiles stop at the image borders, which keeps their mirroring.
+      GLint x0 = std::max(0, x - left);
+      GLint y0 = std::max(0, y - f.bottom);
+      GLint x1 = std::min(desc.width, x + core.width + f.right);
+      GLint y1 = std::min(desc.height, y + core.height + f.top);
+
+      // gles2 has no GL_UNPACK_ROW_LENGTH, copy the tile rows out.
+      size_t rowBytes = (x1 - x0) * bpp;
+      staging.resize(rowBytes * (y1 - y0));
+      for (GLint row = y0; row < y1; ++row) {
+        memcpy(&staging[(row - y0) * rowBytes],
+               src + (static_cast<size_t>(row) * desc.width + x0) * bpp,
+               rowBytes);
+      }
+      ImageDesc tile = { x1 - x0, y1 - y0, desc.format, staging.data() };
+      std::shared_ptr<GLTexture> output = render(tile);
+      if (!output) {
+        return false;
+      }
+      FBOScope fboscope(this);
+      bindRenderTarget(output.get());
+      readRegion(x - x0, y - y0, core, readback, stride);
+    }
+  }
+  return true;
+}
+
+bool
+ImageProcessorWorkflow::setOutputFormat(OutputFormat format,
+                                        GLProgramManager* pm)
+{
+  m_outputPacker.reset();
+  m_outputFormat = OUTPUT_RGBA;
+  m_texturePlans.clear();
+  if (format == OUTPUT_GRAY || format == OUTPUT_BINARY) {
+    std::unique_ptr<PackProcessor> packer(new PackProcessor);
+    if (!packer->init(pm, format == OUTPUT_GRAY
+                            ? PackProcessor::PACK_GRAY
+                            : PackProcessor::PACK_BINARY)) {
+      return false;
+    }
+    m_outputPacker = std::move(packer);
+  }
+  m_outputFormat = format;
+  return true;
+}
+
+GLint
+ImageProcessorWorkflow::readbackWidth(GLint width) const
+{
+  return PackProcessor::packedWidth(width, pixelsPerTexel());
+}
+
+GLint
+ImageProcessorWorkflow::pixelsPerTexel() const
+{
+  switch (m_outputFormat) {
+    case OUTPUT_GRAY:
+      return 4;
+    case OUTPUT_BINARY:
+      return 32;
+    default:
+      return 1;
+  }
+}
+
+std::shared_ptr<GLTexture>
+ImageProcessorWorkflow::uploadInput(const ImageDesc& desc)
+{
+  return m_inputTexture->upload(desc.width, desc.height, desc.format,
+                                desc.data);
+}
+
+std::shared_ptr<GLTexture>
+ImageProcessorWorkflow::render(const ImageDesc& desc)
+{
+  return render(uploadInput(desc), desc.width, desc.height, nullptr);
+}
+
+std::shared_ptr<GLTexture>
+ImageProcessorWorkflow::render(std::shared_ptr<GLTexture> input, GLint width,
+                               GLint height, const ImageRegion* region)
+{
+  m_width = width;
+  m_height = height;
 
   // save old viewport
   glViewport(0, 0, m_width, m_height);
 
-  ProcessorInput pin = { m_width, m_height, scope, this };
-  scope.reset();
-  preallocateTextures();
+  if (!m_planned) {
+    planProcessors();
+  }
+  auto found = m_texturePlans.begin();
+  while (found != m_texturePlans.end() &&
+         (found->width != width || found->height != height)) {
+    ++found;
+  }
+  if (found == m_texturePlans.end()) {
+    m_texturePlans.push_front(TexturePlan{
+      width, height, std::make_shared<FrameTexturePlan>(m_texturePool) });
+  } else {
+    m_texturePlans.splice(m_texturePlans.begin(), m_texturePlans, found);
+  }
+  FrameTexturePlan* plan = m_texturePlans.front().plan.get();
+  plan->beginFrame();
+  trimTexturePlans();
+  m_activeTexturePlan = plan;
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
   glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
   glEnableVertexAttribArray(0);
-  for (auto& p : m_processors) {
-    ProcessorOutput pout = p->process(pin);
-    pin.color = pout.color;
+  GLint ppt = 1;
+  if (m_runPacked) {
+    // the steps read the input packed too.
+    ProcessorInput pin = { width, height, input, this };
+    input = m_lumaPacker->process(pin).color;
+    ppt = 4;
+    m_width = PackProcessor::packedWidth(width, 4);
+    glViewport(0, 0, m_width, m_height);
+  }
+  std::vector<std::shared_ptr<GLTexture>> slots(m_steps.size() + 1);
+  slots[0] = std::move(input);
+  if (region) {
+    glEnable(GL_SCISSOR_TEST);
+  }
+  bool failed = false;
+  for (auto& step : m_steps) {
+    if (region) {
+      // a step covers what it and the steps after it read of the region,
+      // so the passes inside a processor see their whole footprint too.
+      scissorAround(*region, step.reach, width, height, ppt);
+    }
+    ProcessorInput pin = { m_width, m_height, slots[step.inputs[0]], this };
+    for (size_t slot : step.inputs) {
+      pin.inputs.push_back(slots[slot]);
+    }
+    pin.packed = m_runPacked;
+    pin.pixelWidth = width;
+    slots[step.output] = step.processor->process(pin).color;
+    if (!slots[step.output]) {
+      failed = true;
+      break;
+    }
+    for (size_t slot : step.releases) {
+      slots[slot].reset();
+    }
+  }
+  ProcessorInput pin = { m_width, m_height, slots[m_outputSlot], this };
+  slots.clear();
+  if (failed) {
+    pin.color.reset();
+  } else if (m_runPacked && m_outputFormat != OUTPUT_GRAY &&
+             m_outputFormat != OUTPUT_NONE) {
+    if (region) {
+      glScissor(region->x, region->y, region->width, region->height);
+    }
+    pin.pixelWidth = width;
+    pin.color = m_lumaUnpacker->process(pin).color;
+    pin.width = width;
+  }
+  if (pin.color && m_outputPacker &&
+      !(m_runPacked && m_outputFormat == OUTPUT_GRAY)) {
+    if (region) {
+      glScissor(region->x / pixelsPerTexel(), region->y,
+                readbackWidth(region->width), region->height);
+    }
+    pin.color = m_outputPacker->process(pin).color;
   }
   glDisableVertexAttribArray(0);
-  FBOScope fboscope(this);
-  setColorAttachmentForFramebuffer(pin.color->id());
-
-  glPixelStorei(GL_PACK_ALIGNMENT, 4);
-  std::unique_ptr<uint8_t[]> readback(new uint8_t[m_width * m_height * 4]);
-  glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
-               readback.get());
-  // mimic stale scope
-  m_staled = true;
-  m_fbotextures.clear();
+  if (region) {
+    glDisable(GL_SCISSOR_TEST);
+  }
+  m_activeTexturePlan = nullptr;
   m_width = 0;
   m_height = 0;
-  m_staled = false;
   // clean up state.
   glBindBuffer(GL_ARRAY_BUFFER, 0);
-  return ImageOutput{ std::move(readback) };
+  return pin.color;
 }
 
 void
@@ -114,17 +676,17 @@ ImageProcessorWorkflow::checkFramebuffer()
 std::shared_ptr<GLTexture>
 ImageProcessorWorkflow::requestTextureForFramebuffer()
 {
-  if (m_fbotextures.empty()) {
-    GLuint texture;
-    CHECK_CONTEXT_NOT_NULL();
-    glGenTextures(1, &texture);
-    allocateTexture(texture, m_width, m_height, GL_RGBA);
-    std::shared_ptr<GLTexture> resource(new GLRebornTexture(texture, this));
-    return resource;
+  return requestTextureForFramebuffer(m_width, m_height, GL_RGBA);
+}
+
+std::shared_ptr<GLTexture>
+ImageProcessorWorkflow::requestTextureForFramebuffer(GLint width, GLint height,
+                                                     GLenum internalFormat)
+{
+  if (m_activeTexturePlan) {
+    return m_activeTexturePlan->acquire(width, height, internalFormat);
   }
-  std::shared_ptr<GLTexture> resource(m_fbotextures.back());
-  m_fbotextures.pop_back();
-  return resource;
+  return m_texturePool->acquire(width, height, internalFormat);
 }
 
 void
@@ -134,44 +696,55 @@ ImageProcessorWorkflow::setColorAttachmentForFramebuffer(GLuint texture)
                          texture, 0);
 }
 
-bool
-ImageProcessorWorkflow::rebornTexture(GLuint texture)
+void
+ImageProcessorWorkflow::bindRenderTarget(GLTexture* texture)
 {
-  if (m_staled || m_fbotextures.size() > s_preallocateTextureCount) {
-    return false;
+  if (texture->framebuffer()) {
+    glBindFramebuffer(GL_FRAMEBUFFER, texture->framebuffer());
+    return;
   }
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  setColorAttachmentForFramebuffer(texture->id());
+}
 
-  m_fbotextures.push_back(
-    std::move(std::unique_ptr<GLTexture>(new GLRebornTexture(texture, this))));
-  return true;
+void
+ImageProcessorWorkflow::assertFramebufferComplete(int line, const char* file)
+{
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    GLIMPROC_LOGE("file: %s, lineno: %d: fbo is not completed %x.\n", file,
+                  line, status);
+    exit(1);
+  }
 }
 
 void
-ImageProcessorWorkflow::allocateTexture(GLuint texture, GLint width,
-                                        GLint height, GLenum format, void* data)
+ImageProcessorWorkflow::setTexturePoolBudget(size_t budget)
 {
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-               GL_UNSIGNED_BYTE, data);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+  m_texturePool->setBudget(budget);
+  trimTexturePlans();
 }
 
 void
-ImageProcessorWorkflow::preallocateTextures()
+ImageProcessorWorkflow::trimTexturePlans()
 {
-  GLuint textures[s_preallocateTextureCount];
+  // the plans hold their textures out of the idle list of the pool, which
+  // can not evict them, so the least recently used plans give theirs back.
+  while (m_texturePlans.size() > 1 &&
+         m_texturePool->allocatedBytes() > m_texturePool->budget()) {
+    m_texturePlans.pop_back();
+  }
+}
 
-  CHECK_CONTEXT_NOT_NULL();
-  glGenTextures(s_preallocateTextureCount, textures);
-  m_fbotextures.reserve(s_preallocateTextureCount);
-  for (int i = 0; i < s_preallocateTextureCount; ++i) {
-    m_fbotextures.push_back(std::move(
-      std::unique_ptr<GLTexture>(new GLRebornTexture(textures[i], this))));
-    allocateTexture(textures[i], m_width, m_height, GL_RGBA);
+size_t
+ImageProcessorWorkflow::plannedPeakBytes(GLint width, GLint height) const
+{
+  for (auto& p : m_texturePlans) {
+    if (p.width == width && p.height == height) {
+      return p.plan->planned() ? p.plan->peakBytes() : 0;
+    }
   }
+  return 0;
 }
 
 FBOScope::FBOScope(ImageProcessorWorkflow* wf)
@@ -184,16 +757,3 @@ FBOScope::~FBOScope()
 {
   m_wf->leaveFramebuffer();
 }
-
-GLRebornTexture::GLRebornTexture(GLuint id, ImageProcessorWorkflow* wf)
-  : GLTexture(id)
-  , m_wf(wf)
-{
-}
-
-GLRebornTexture::~GLRebornTexture()
-{
-  if (m_wf->rebornTexture(id())) {
-    reset();
-  }
-}
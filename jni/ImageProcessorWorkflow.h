@@ -1,7 +1,11 @@
 #ifndef IMAGEPROCESSORWORKFLOW_H
 #define IMAGEPROCESSORWORKFLOW_H
+#include "AsyncReadback.h"
 #include "GLCommon.h"
+#include "ProcessorGraph.h"
+#include <list>
 #include <memory>
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
@@ -12,13 +16,42 @@ struct ImageDesc
   void* data;
 };
 
+// pixels of an image, x and y counted from its first row and column.
+struct ImageRegion
+{
+  GLint x, y, width, height;
+};
+
+enum OutputFormat
+{
+  OUTPUT_RGBA,
+  // the red channel only, one byte per pixel, packed on the GPU.
+  OUTPUT_GRAY,
+  // one bit per pixel, set where the red channel is nonzero, most
+  // significant bit first, packed on the GPU.
+  OUTPUT_BINARY,
+  // nothing is read back, for processors whose results are read on their
+  // own, see ConnectedComponentsProcessor. images are rendered whole, never
+  // tiled nor cut to regions.
+  OUTPUT_NONE,
+};
+
 struct ImageOutput
 {
   std::unique_ptr<uint8_t[]> outputBytes;
+  OutputFormat format;
+  // bytes between the starts of two rows.
+  GLint stride;
 };
 
+class FrameTexturePlan;
+class GLProgramManager;
 class GLTexture;
+class GLTexturePool;
 class IImageProcessor;
+class InputTexture;
+class ReadbackRing;
+struct ProcessorDescription;
 
 class ImageProcessorWorkflow final
 {
@@ -26,26 +59,151 @@ public:
   ImageProcessorWorkflow();
   ~ImageProcessorWorkflow();
   void registerIImageProcessor(IImageProcessor* processor);
+  // the output has no bytes when the image cannot be processed: a processor
+  // reading the whole image meets one exceeding the texture size, the
+  // footprint of the processors leaves no room for a tile, or a processor
+  // fails.
   ImageOutput process(const ImageDesc& desc);
+  // processes only the given regions, each pass renders just the region
+  // widened by the footprints of the passes left. the output is laid out
+  // like that of process(), bytes outside the regions are zero. for the
+  // packed formats regions are widened to whole texels.
+  ImageOutput process(const ImageDesc& desc,
+                      const std::vector<ImageRegion>& regions);
+  // like process(), but on a GLES3 context the readback lands in a pixel
+  // buffer object and overlaps with whatever the caller submits next. map()
+  // returns null when the image cannot be processed.
+  ImageOutputFuture processAsync(const ImageDesc& desc);
   void enterFramebuffer();
   void leaveFramebuffer();
   GLint checkFramebuffer();
   std::shared_ptr<GLTexture> requestTextureForFramebuffer();
+  std::shared_ptr<GLTexture> requestTextureForFramebuffer(
+    GLint width, GLint height, GLenum internalFormat);
   void setColorAttachmentForFramebuffer(GLuint texture);
-  bool rebornTexture(GLuint texture);
+  // binds the prebuilt framebuffer of a pooled texture, or attaches any
+  // other texture to the framebuffer of the workflow.
+  void bindRenderTarget(GLTexture* texture);
+  // logs and exits unless the bound framebuffer is complete.
+  void assertFramebufferComplete(int line, const char* file);
+  // OUTPUT_GRAY and OUTPUT_BINARY render a packing pass with programs
+  // from pm.
+  bool setOutputFormat(OutputFormat format, GLProgramManager* pm);
+  // bytes of render targets kept alive between process() calls, the
+  // texture plans of the geometries rendered included: the least recently
+  // used plans are dropped while the pool is over budget.
+  void setTexturePoolBudget(size_t budget);
+  // bytes of render targets live at once while rendering an image of
+  // this size, known once one has been processed. 0 before.
+  size_t plannedPeakBytes(GLint width, GLint height) const;
+  // run runs of described processors as generated fused passes, see
+  // PassFusionPlanner. the plan is made on the next process() call.
+  void enablePassFusion(GLProgramManager* pm);
+  // rewrite runs of described processors into a cheaper equivalent
+  // sequence before running or fusing them, see PipelineOptimizer.
+  void enablePipelineOptimization(GLProgramManager* pm);
+  // images larger than tileSize, or than GL_MAX_TEXTURE_SIZE less the
+  // scratch extents of the processors, are processed in tiles of at most
+  // tileSize output pixels per side (the width rounded up to a multiple of
+  // 32), each rendered with a halo covering the footprints of the
+  // processors. 0 tiles only images that do not fit in a texture. images
+  // are never tiled under a processor reading the whole image.
+  void setTileSize(GLint tileSize);
+  // run graph instead of the registered chain, without fusion or
+  // optimization. the graph is scheduled on the next process() call and
+  // must outlive the workflow or be replaced.
+  void setProcessorGraph(ProcessorGraph* graph);
+  // images of the same geometry are uploaded into one texture kept across
+  // calls. on a GLES3 context, count > 0 stages them through a ring of
+  // that many pixel unpack buffers so the upload runs asynchronously.
+  void setInputUnpackBuffers(size_t count);
+  // run the processors on the red channel alone, four pixels to an RGBA
+  // texel as laid out by OUTPUT_GRAY, with the packed variants of their
+  // shaders: a first pass packs the input, the textures are a quarter as
+  // wide. OUTPUT_GRAY reads the last texture back as is, OUTPUT_RGBA and
+  // OUTPUT_BINARY unpack it first. runs unpacked, with a log, when a
+  // processor has no packed variant. pass fusion is skipped unless the
+  // chain ends up running unpacked.
+  bool setPackedLuma(bool enable, GLProgramManager* pm);
 
 private:
-  void preallocateTextures();
-  void allocateTexture(GLuint texture, GLint width, GLint height, GLenum format,
-                       void* data = nullptr);
+  std::shared_ptr<GLTexture> uploadInput(const ImageDesc& desc);
+  // null when a processor fails.
+  std::shared_ptr<GLTexture> render(const ImageDesc& desc);
+  std::shared_ptr<GLTexture> render(std::shared_ptr<GLTexture> input,
+                                    GLint width, GLint height,
+                                    const ImageRegion* region);
+  // false when the image cannot be processed, tiled or not.
+  bool tileGeometry(const ImageDesc& desc, bool* tiled, GLint* tileWidth,
+                    GLint* tileHeight);
+  ImageOutput processTiled(const ImageDesc& desc, GLint tileWidth,
+                           GLint tileHeight);
+  // false when a tile fails to render.
+  bool processTiles(const ImageDesc& desc, const ImageRegion& region,
+                    GLint tileWidth, GLint tileHeight, uint8_t* readback,
+                    GLint stride);
+  void readRegion(GLint x, GLint y, const ImageRegion& dst,
+                  uint8_t* readback, GLint stride);
+  bool clipRegion(const ImageRegion& region, const ImageDesc& desc,
+                  ImageRegion* clipped) const;
+  ProcessorFootprint planFootprint() const;
+  GLint readbackWidth(GLint width) const;
+  GLint pixelsPerTexel() const;
+  void trimTexturePlans();
+  void planProcessors();
+  // plans the chain and schedules the steps, packed or not by m_runPacked.
+  void scheduleSteps();
+  void planChain();
+  bool planRun(std::vector<ProcessorDescription> descs);
   std::vector<IImageProcessor*> m_processors;
-  std::vector<std::shared_ptr<GLTexture>> m_fbotextures;
+  // the registered processors, or the planned ones.
+  std::vector<IImageProcessor*> m_plan;
+  std::vector<std::unique_ptr<IImageProcessor>> m_plannedProcessors;
+  // what process() runs: m_plan as a chain, or the graph.
+  ProcessorGraph* m_graph;
+  std::vector<ProcessorStep> m_steps;
+  size_t m_outputSlot;
+  ProcessorFootprint m_footprint;
+  // the largest scratch extent of the steps.
+  ProcessorExtent m_scratchExtent;
+  std::shared_ptr<GLTexturePool> m_texturePool;
+  struct TexturePlan
+  {
+    GLint width, height;
+    std::shared_ptr<FrameTexturePlan> plan;
+  };
+  // one per geometry rendered since the last planning, most recently used
+  // at the front.
+  std::list<TexturePlan> m_texturePlans;
+  FrameTexturePlan* m_activeTexturePlan;
+  std::unique_ptr<ReadbackRing> m_readbackRing;
+  std::unique_ptr<InputTexture> m_inputTexture;
+  std::unique_ptr<IImageProcessor> m_outputPacker;
+  std::unique_ptr<IImageProcessor> m_lumaPacker;
+  std::unique_ptr<IImageProcessor> m_lumaUnpacker;
   GLuint m_fbo;
   GLint m_width, m_height;
   GLuint m_vbo;
-  bool m_staled;
+  OutputFormat m_outputFormat;
+  GLint m_tileSize;
+  GLProgramManager* m_programManager;
+  bool m_fusePasses;
+  bool m_optimizePipeline;
+  bool m_planned;
+  bool m_packedLuma;
+  // whether the planned steps run on packed luma.
+  bool m_runPacked;
 };
 
+// render targets are validated when their framebuffer is built, so the
+// per pass check only runs in debug builds.
+#if defined(NDEBUG)
+#define CHECK_FRAMEBUFFER_COMPLETE(wf)
+#else
+#define CHECK_FRAMEBUFFER_COMPLETE(wf)                                         \
+  (wf)->assertFramebufferComplete(__LINE__, __FILE__)
+#endif
+
 class FBOScope
 {
 public:
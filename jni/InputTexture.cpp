@@ -0,0 +1,109 @@
+#include "InputTexture.h"
+#include "GLResources.h"
+#include <GLES3/gl3.h>
+#include <string.h>
+
+InputTexture::InputTexture()
+  : m_width(0)
+  , m_height(0)
+  , m_format(0)
+  , m_bufferCount(0)
+  , m_nextBuffer(0)
+  , m_bufferSize(0)
+{
+}
+
+InputTexture::~InputTexture()
+{
+  releaseBuffers();
+}
+
+void
+InputTexture::setUnpackBufferCount(size_t count)
+{
+  releaseBuffers();
+  m_bufferCount = count;
+}
+
+std::shared_ptr<GLTexture>
+InputTexture::upload(GLint width, GLint height, GLenum format,
+                     const void* data)
+{
+  CHECK_CONTEXT_NOT_NULL();
+  // rows of data are tightly packed.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (!m_texture || width != m_width || height != m_height ||
+      format != m_format) {
+    // redefine the storage in place, the name is kept.
+    if (!m_texture) {
+      GLuint texture;
+      glGenTextures(1, &texture);
+      m_texture = std::make_shared<GLTexture>(texture);
+    }
+    allocateTexture(m_texture->id(), width, height, format, data);
+    m_width = width;
+    m_height = height;
+    m_format = format;
+    return m_texture;
+  }
+  glBindTexture(GL_TEXTURE_2D, m_texture->id());
+  if (m_bufferCount && isGLES3Context()) {
+    uploadThroughBuffer(
+      static_cast<size_t>(width) * height * bytesPerPixel(format), data);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format,
+                    GL_UNSIGNED_BYTE, data);
+  }
+  return m_texture;
+}
+
+void
+InputTexture::uploadThroughBuffer(size_t size, const void* data)
+{
+  if (m_buffers.empty()) {
+    m_buffers.resize(m_bufferCount);
+    glGenBuffers(m_buffers.size(), m_buffers.data());
+    m_bufferSize = 0;
+  }
+  GLuint buffer = m_buffers[m_nextBuffer];
+  m_nextBuffer = (m_nextBuffer + 1) % m_buffers.size();
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+  if (size > m_bufferSize) {
+    for (GLuint b : m_buffers) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    m_bufferSize = size;
+  }
+  // invalidating lets the driver hand out fresh storage instead of
+  // waiting for an upload still reading the buffer.
+  void* mapped = glMapBufferRange(
+    GL_PIXEL_UNPACK_BUFFER, 0, size,
+    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    GLIMPROC_LOGE("fails to map an unpack buffer, uploading directly.\n");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, m_format,
+                    GL_UNSIGNED_BYTE, data);
+    return;
+  }
+  memcpy(mapped, data, size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, m_format,
+                  GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void
+InputTexture::releaseBuffers()
+{
+  if (m_buffers.empty()) {
+    return;
+  }
+  CHECK_CONTEXT_NOT_NULL();
+  glDeleteBuffers(m_buffers.size(), m_buffers.data());
+  m_buffers.clear();
+  m_nextBuffer = 0;
+  m_bufferSize = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef INPUTTEXTURE_H
+#define INPUTTEXTURE_H
+#include "GLCommon.h"
+#include <memory>
+#include <stddef.h>
+#include <vector>
+
+class GLTexture;
+
+// The texture images are uploaded into, kept across frames and refilled
+// with glTexSubImage2D while their geometry stays the same. With unpack
+// buffers (GLES3) the pixels are copied into the next buffer of a ring and
+// the texture is filled from that buffer, so upload() returns before the
+// GPU has fetched them and frame N + 1 can be written while frame N is
+// still being read.
+class InputTexture final
+{
+public:
+  InputTexture();
+  ~InputTexture();
+  InputTexture(const InputTexture&) = delete;
+  InputTexture& operator=(const InputTexture&) = delete;
+  // 0 uploads straight from host memory. ignored below GLES3.
+  void setUnpackBufferCount(size_t count);
+  // rows of data are tightly packed. the texture is only valid until the
+  // next upload.
+  std::shared_ptr<GLTexture> upload(GLint width, GLint height, GLenum format,
+                                    const void* data);
+
+private:
+  void uploadThroughBuffer(size_t size, const void* data);
+  void releaseBuffers();
+  std::shared_ptr<GLTexture> m_texture;
+  GLint m_width, m_height;
+  GLenum m_format;
+  std::vector<GLuint> m_buffers;
+  size_t m_bufferCount;
+  size_t m_nextBuffer;
+  size_t m_bufferSize;
+};
+#endif /* INPUTTEXTURE_H */
@@ -0,0 +1,108 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded multi-producer multi-consumer queue after Dmitry Vyukov's
+// design. Each cell carries a sequence number telling whether it is ready
+// to be filled or drained at the current lap; producers and consumers
+// claim cells by compare-and-swap on the tail and head, never by a lock.
+template <typename T>
+class LockFreeQueue final
+{
+public:
+  // capacity is rounded up to a power of two.
+  explicit LockFreeQueue(size_t capacity);
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+  // value is only moved from when it was queued.
+  bool tryPush(T&& value);
+  bool tryPop(T* value);
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask;
+  // keep producers and consumers off each other's cache line.
+  char m_pad0[64];
+  std::atomic<size_t> m_tail;
+  char m_pad1[64];
+  std::atomic<size_t> m_head;
+  char m_pad2[64];
+};
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+  : m_mask(0)
+  , m_tail(0)
+  , m_head(0)
+{
+  size_t size = 2;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_cells.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i) {
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  m_mask = size - 1;
+}
+
+template <typename T>
+bool
+LockFreeQueue<T>::tryPush(T&& value)
+{
+  size_t pos = m_tail.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = m_cells[pos & m_mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff =
+      static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+        cell.value = std::move(value);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // the cell still holds the value of the previous lap: full.
+      return false;
+    } else {
+      pos = m_tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T>
+bool
+LockFreeQueue<T>::tryPop(T* value)
+{
+  size_t pos = m_head.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = m_cells[pos & m_mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff =
+      static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (m_head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+        *value = std::move(cell.value);
+        cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // the cell has not been filled at this lap yet: empty.
+      return false;
+    } else {
+      pos = m_head.load(std::memory_order_relaxed);
+    }
+  }
+}
+#endif /* LOCKFREEQUEUE_H */
@@ -0,0 +1,134 @@
+#include "MorphologyDoubling.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string>
+
+MorphologyDoubling::MorphologyDoubling()
+  : m_passes()
+{
+}
+
+bool
+MorphologyDoubling::init(GLProgramManager* pm, bool dilate)
+{
+  for (int variant = 0; variant < VARIANT_COUNT; ++variant) {
+    std::string defines =
+      dilate ? "#define COMBINE max\n" : "#define COMBINE min\n";
+    if (variant & UNPACK) {
+      defines += "#define UNPACK\n";
+    }
+    if (variant & PACK) {
+      defines += "#define PACK\n";
+    }
+    Pass& pass = m_passes[variant];
+    pass.program =
+      pm->getProgram(GLProgramManager::MORPHOLOGYDOUBLING, defines);
+    if (!pass.program) {
+      return false;
+    }
+    GLint program = pass.program;
+    pass.uTexture = glGetUniformLocation(program, "u_texture");
+    pass.uTextureSize = glGetUniformLocation(program, "u_textureSize");
+    pass.uAxis = glGetUniformLocation(program, "u_axis");
+    pass.uOffset = glGetUniformLocation(program, "u_offset");
+    pass.uStride = glGetUniformLocation(program, "u_stride");
+    pass.uImageWidth = glGetUniformLocation(program, "u_imageWidth");
+  }
+  return checkError("MorphologyDoubling::init");
+}
+
+void
+MorphologyDoubling::process(const ProcessorInput& pin, GLTexture* source,
+                            MorphologyPlan::Axis axis, GLint size,
+                            GLint before, GLTexture* target)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  bool packed = pin.packed && axis == MorphologyPlan::ROW;
+  GLint along = axis == MorphologyPlan::ROW ? 0 : 1;
+  // the padding lanes of the last texel are computed like any pixel.
+  GLint pixels = packed ? 4 * pin.width : pin.width;
+  GLint length =
+    (axis == MorphologyPlan::ROW ? pixels : pin.height) + size - 1;
+  GLint width = axis == MorphologyPlan::ROW ? length : pin.width;
+  GLint height = axis == MorphologyPlan::ROW ? pin.height : length;
+  GLfloat axisVector[2] = { 0.0, 0.0 };
+  axisVector[along] = 1.0;
+  GLfloat sourceSize[2] = { static_cast<GLfloat>(pin.width),
+                            static_cast<GLfloat>(pin.height) };
+  GLfloat passSize[2] = { static_cast<GLfloat>(width),
+                          static_cast<GLfloat>(height) };
+
+  // the windows of the scissor start in it and end size - 1 further.
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  GLint box[4];
+  glGetIntegerv(GL_SCISSOR_BOX, box);
+  if (scissor) {
+    GLint passBox[4] = { box[0], box[1], box[2], box[3] };
+    GLint start = box[along], end = box[along] + box[along + 2];
+    if (packed) {
+      start *= 4;
+      end *= 4;
+    }
+    passBox[along] = start;
+    passBox[along + 2] = std::min(length, end + size - 1) - start;
+    glScissor(passBox[0], passBox[1], passBox[2], passBox[3]);
+  }
+  glViewport(0, 0, width, height);
+
+  std::shared_ptr<GLTexture> windows[2];
+  size_t current = 0;
+  GLTexture* input = source;
+  GLint stride = 1;
+  glActiveTexture(GL_TEXTURE0);
+  for (;; stride *= 2) {
+    bool last = 2 * stride >= size;
+    int variant = 0;
+    if (packed && input == source) {
+      variant |= UNPACK;
+    }
+    if (last) {
+      glViewport(0, 0, pin.width, pin.height);
+      if (scissor) {
+        glScissor(box[0], box[1], box[2], box[3]);
+      }
+      wf->bindRenderTarget(target);
+      if (packed) {
+        variant |= PACK;
+      }
+    } else {
+      if (!windows[current]) {
+        windows[current] =
+          wf->requestTextureForFramebuffer(width, height, GL_RGBA);
+      }
+      wf->bindRenderTarget(windows[current].get());
+    }
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    const Pass& pass = m_passes[variant];
+    glBindTexture(GL_TEXTURE_2D, input->id());
+    glUseProgram(pass.program);
+    glUniform1i(pass.uTexture, 0);
+    glUniform2fv(pass.uTextureSize, 1,
+                 input == source ? sourceSize : passSize);
+    glUniform2fv(pass.uAxis, 1, axisVector);
+    // only the first pass reads the source, mirrored by the sampler.
+    glUniform1f(pass.uOffset,
+                input == source ? static_cast<GLfloat>(-before) : 0.0f);
+    // the two windows of the last pass overlap unless size is 2 stride.
+    glUniform1f(pass.uStride,
+                static_cast<GLfloat>(last ? size - stride : stride));
+    if (variant & UNPACK) {
+      glUniform1f(pass.uImageWidth, static_cast<GLfloat>(pin.pixelWidth));
+    }
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    if (last) {
+      break;
+    }
+    input = windows[current].get();
+    current ^= 1;
+  }
+  checkError("MorphologyDoubling::process");
+}
@@ -0,0 +1,47 @@
+#ifndef MORPHOLOGYDOUBLING_H
+#define MORPHOLOGYDOUBLING_H
+#include "MorphologyPlan.h"
+
+class GLProgramManager;
+class GLTexture;
+
+// The maximum or minimum over a window of size pixels along rows or
+// columns in passes with doubling strides. A pass turns the windows of s
+// pixels into those of 2s pixels by combining each with the one s pixels
+// further, the last pass overlaps two windows of the largest power of two
+// below size. Exact, 2 fetches per pixel in ceil(log2(size)) passes.
+class MorphologyDoubling final
+{
+public:
+  MorphologyDoubling();
+  // dilate takes the maximum, otherwise the minimum.
+  bool init(GLProgramManager* pm, bool dilate);
+  // renders into target the window of size pixels starting before pixels
+  // ahead of each pixel of source, which is pin.width x pin.height. with
+  // pin.packed, a ROW window runs over the pixels of the packed texels, a
+  // COLUMN one over the texels as they are.
+  void process(const ProcessorInput& pin, GLTexture* source,
+               MorphologyPlan::Axis axis, GLint size, GLint before,
+               GLTexture* target);
+
+private:
+  // a variant of the pass reading and writing packed rows or not.
+  enum
+  {
+    UNPACK = 1,
+    PACK = 2,
+    VARIANT_COUNT = 4,
+  };
+  struct Pass
+  {
+    GLint program;
+    GLint uTexture;
+    GLint uTextureSize;
+    GLint uAxis;
+    GLint uOffset;
+    GLint uStride;
+    GLint uImageWidth;
+  };
+  Pass m_passes[VARIANT_COUNT];
+};
+#endif /* MORPHOLOGYDOUBLING_H */
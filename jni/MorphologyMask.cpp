@@ -0,0 +1,107 @@
+#include "MorphologyMask.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdlib.h>
+#include <string>
+
+MorphologyMask::MorphologyMask()
+  : m_maskSize{ 0, 0 }
+  , m_anchor{ 0.0, 0.0 }
+  , m_uTextureMask(0)
+  , m_uMaskMask(0)
+  , m_uTextureSizeMask(0)
+  , m_uMaskSizeMask(0)
+  , m_uAnchorMask(0)
+  , m_programMask(0)
+  , m_uFirstMerge(0)
+  , m_uSecondMerge(0)
+  , m_uTextureSizeMerge(0)
+  , m_programMerge(0)
+{
+}
+
+bool
+MorphologyMask::init(GLProgramManager* pm, bool dilate,
+                     const StructuringElement& element)
+{
+  std::string defines = dilate
+                          ? "#define COMBINE max\n#define IDENTITY 0.0\n"
+                          : "#define COMBINE min\n#define IDENTITY 1.0\n";
+  m_programMask = pm->getProgram(GLProgramManager::MORPHOLOGYMASK, defines);
+  m_programMerge =
+    pm->getProgram(GLProgramManager::MORPHOLOGYMERGE, defines);
+  if (!m_programMask || !m_programMerge) {
+    return false;
+  }
+  GLint program = m_programMask;
+  m_uTextureMask = glGetUniformLocation(program, "u_texture");
+  m_uMaskMask = glGetUniformLocation(program, "u_mask");
+  m_uTextureSizeMask = glGetUniformLocation(program, "u_textureSize");
+  m_uMaskSizeMask = glGetUniformLocation(program, "u_maskSize");
+  m_uAnchorMask = glGetUniformLocation(program, "u_anchor");
+
+  program = m_programMerge;
+  m_uFirstMerge = glGetUniformLocation(program, "u_first");
+  m_uSecondMerge = glGetUniformLocation(program, "u_second");
+  m_uTextureSizeMerge = glGetUniformLocation(program, "u_textureSize");
+
+  m_maskSize[0] = element.width();
+  m_maskSize[1] = element.height();
+  m_anchor[0] = static_cast<GLfloat>(element.anchorX());
+  m_anchor[1] = static_cast<GLfloat>(element.anchorY());
+  GLuint texture;
+  glGenTextures(1, &texture);
+  m_mask = std::make_shared<GLTexture>(texture);
+  // rows of the mask are tightly packed.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  allocateTexture(texture, m_maskSize[0], m_maskSize[1], GL_LUMINANCE,
+                  element.mask().data());
+  return checkError("MorphologyMask::init");
+}
+
+void
+MorphologyMask::process(const ProcessorInput& pin, GLTexture* source,
+                        GLTexture* target)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLfloat textureSize[2] = { static_cast<GLfloat>(pin.width),
+                             static_cast<GLfloat>(pin.height) };
+  wf->bindRenderTarget(target);
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source->id());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, m_mask->id());
+  glUseProgram(m_programMask);
+  glUniform1i(m_uTextureMask, 0);
+  glUniform1i(m_uMaskMask, 1);
+  glUniform2fv(m_uTextureSizeMask, 1, textureSize);
+  glUniform2iv(m_uMaskSizeMask, 1, m_maskSize);
+  glUniform2fv(m_uAnchorMask, 1, m_anchor);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void
+MorphologyMask::merge(const ProcessorInput& pin, GLTexture* first,
+                      GLTexture* second, GLTexture* target)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLfloat textureSize[2] = { static_cast<GLfloat>(pin.width),
+                             static_cast<GLfloat>(pin.height) };
+  wf->bindRenderTarget(target);
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, first->id());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, second->id());
+  glUseProgram(m_programMerge);
+  glUniform1i(m_uFirstMerge, 0);
+  glUniform1i(m_uSecondMerge, 1);
+  glUniform2fv(m_uTextureSizeMerge, 1, textureSize);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+}
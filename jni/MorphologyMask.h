@@ -0,0 +1,45 @@
+#ifndef MORPHOLOGYMASK_H
+#define MORPHOLOGYMASK_H
+#include "StructuringElement.h"
+#include <memory>
+
+class GLProgramManager;
+class GLTexture;
+
+// The passes of a structuring element that are not separable: the
+// maximum or minimum under a mask texture, for elements that decompose
+// into too many rectangles, and the merge of the results of those
+// rectangles.
+class MorphologyMask final
+{
+public:
+  MorphologyMask();
+  // dilate takes the maximum, otherwise the minimum.
+  bool init(GLProgramManager* pm, bool dilate,
+            const StructuringElement& element);
+  // renders into target the element applied to source, which is
+  // pin.width x pin.height and not packed.
+  void process(const ProcessorInput& pin, GLTexture* source,
+               GLTexture* target);
+  // renders into target the maximum or minimum of first and second.
+  void merge(const ProcessorInput& pin, GLTexture* first, GLTexture* second,
+             GLTexture* target);
+
+private:
+  std::shared_ptr<GLTexture> m_mask;
+  GLint m_maskSize[2];
+  GLfloat m_anchor[2];
+
+  GLint m_uTextureMask;
+  GLint m_uMaskMask;
+  GLint m_uTextureSizeMask;
+  GLint m_uMaskSizeMask;
+  GLint m_uAnchorMask;
+  GLint m_programMask;
+
+  GLint m_uFirstMerge;
+  GLint m_uSecondMerge;
+  GLint m_uTextureSizeMerge;
+  GLint m_programMerge;
+};
+#endif /* MORPHOLOGYMASK_H */
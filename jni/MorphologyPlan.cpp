@@ -0,0 +1,103 @@
+#include "MorphologyPlan.h"
+#include <algorithm>
+#include <initializer_list>
+
+// measured on llvmpipe, where a pass of two fetches costs about as much as
+// three taps of a direct pass.
+const double MorphologyPlan::s_writeCost = 1.0;
+// a pixel of a scan draw, a quad one pixel thin, costs about two fetches
+// more than one of a full screen pass.
+const double MorphologyPlan::s_scanDrawCost = 2.0;
+
+MorphologyPlan::Method
+MorphologyPlan::choose(const ProcessorInput& pin, Axis axis, GLint size)
+{
+  Method best = DIRECT;
+  double bestCost = cost(pin, axis, size, DIRECT);
+  for (Method method : { SCAN, DOUBLING }) {
+    double c = cost(pin, axis, size, method);
+    if (c < bestCost) {
+      best = method;
+      bestCost = c;
+    }
+  }
+  return best;
+}
+
+double
+MorphologyPlan::cost(const ProcessorInput& pin, Axis axis, GLint size,
+                     Method method)
+{
+  // packed rows are read four pixels per texel by the direct pass only,
+  // the other methods unpack them and pack the last pass again.
+  bool packedRow = pin.packed && axis == ROW;
+  double lanes = packedRow ? 4.0 : 1.0;
+  double lines = axis == ROW ? pin.height : pin.width;
+  double texels = lines * (axis == ROW ? pin.width : pin.height);
+  double padded =
+    lines * ((axis == ROW ? lanes * pin.width : pin.height) + size - 1);
+  int passes = 0;
+  switch (method) {
+    case DIRECT:
+      if (packedRow) {
+        // each texel fetched feeds the windows of all four lanes.
+        return texels * ((size + 3) / 4 + 1 + s_writeCost);
+      }
+      return texels * (size + s_writeCost);
+    case SCAN:
+      // the combine fetches both parities of both scans.
+      return 2 * padded * (2.0 + s_writeCost + s_scanDrawCost) +
+             texels * (4.0 * lanes + s_writeCost);
+    case DOUBLING:
+      for (GLint stride = 1; 2 * stride < size; stride *= 2) {
+        ++passes;
+      }
+      return passes * padded * (2.0 + s_writeCost) +
+             texels * (2.0 * lanes + s_writeCost);
+  }
+  return 0.0;
+}
+
+double
+MorphologyPlan::cost(
+  const ProcessorInput& pin,
+  const std::vector<StructuringElement::Rectangle>& rectangles)
+{
+  double total = 0.0;
+  for (const auto& r : rectangles) {
+    if (r.width != 1 || r.x != 0) {
+      total += cost(pin, ROW, r.width, choose(pin, ROW, r.width));
+    }
+    if (r.height != 1 || r.y != 0) {
+      total += cost(pin, COLUMN, r.height, choose(pin, COLUMN, r.height));
+    }
+  }
+  double texels = static_cast<double>(pin.width) * pin.height;
+  return total + (rectangles.size() - 1) * texels * (2.0 + s_writeCost);
+}
+
+double
+MorphologyPlan::maskCost(const ProcessorInput& pin,
+                         const StructuringElement& element)
+{
+  const std::vector<uint8_t>& mask = element.mask();
+  double cells = mask.size();
+  double set = std::count(mask.begin(), mask.end(), 255);
+  double texels = static_cast<double>(pin.width) * pin.height;
+  // the branch on every cell costs about as much as its fetch on llvmpipe.
+  return texels * (2.0 * cells + set + s_writeCost);
+}
+
+ProcessorExtent
+MorphologyPlan::extent(
+  const std::vector<StructuringElement::Rectangle>& rectangles)
+{
+  // both span size - 1 positions past the line, packed rows the padding
+  // lanes of their last texel too, up to three pixels past the image.
+  ProcessorExtent e = { 0, 0 };
+  for (const auto& r : rectangles) {
+    e.width = std::max(e.width, r.width - 1 + 3);
+    e.height = std::max(e.height, r.height - 1);
+  }
+  return e;
+}
@@ -0,0 +1,49 @@
+#ifndef MORPHOLOGYPLAN_H
+#define MORPHOLOGYPLAN_H
+#include "IImageProcessor.h"
+#include "StructuringElement.h"
+#include <vector>
+
+// Picks how a pass of a separable morphology kernel takes the maximum or
+// minimum over its window of size pixels, from a rough count of the
+// fetches and writes of every method.
+class MorphologyPlan final
+{
+public:
+  enum Axis
+  {
+    ROW,
+    COLUMN,
+  };
+  enum Method
+  {
+    // size fetches per pixel, one pass.
+    DIRECT,
+    // MorphologyScan: 8 fetches per pixel in 2 size draws and a pass.
+    SCAN,
+    // MorphologyDoubling: 2 fetches per pixel in log2(size) passes.
+    DOUBLING,
+  };
+  static Method choose(const ProcessorInput& pin, Axis axis, GLint size);
+  // in fetches, a texel written counting as s_writeCost of them.
+  static double cost(const ProcessorInput& pin, Axis axis, GLint size,
+                     Method method);
+  // the cheapest passes of every rectangle of a decomposed element and the
+  // merges of their results. passes over a single pixel are skipped.
+  static double cost(
+    const ProcessorInput& pin,
+    const std::vector<StructuringElement::Rectangle>& rectangles);
+  // one pass fetching every cell of the mask and the pixels of the set
+  // ones, on unpacked images.
+  static double maskCost(const ProcessorInput& pin,
+                         const StructuringElement& element);
+  // how far the scan and doubling passes of the rectangles reach past the
+  // image, see IImageProcessor::scratchExtent.
+  static ProcessorExtent extent(
+    const std::vector<StructuringElement::Rectangle>& rectangles);
+
+private:
+  static const double s_writeCost;
+  static const double s_scanDrawCost;
+};
+#endif /* MORPHOLOGYPLAN_H */
@@ -0,0 +1,223 @@
+#include "MorphologyScan.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+MorphologyScan::MorphologyScan()
+  : m_scans()
+  , m_combines()
+  , m_blocks(0)
+  , m_blockCount(0)
+{
+}
+
+MorphologyScan::~MorphologyScan()
+{
+  if (m_blocks) {
+    CHECK_CONTEXT_NOT_NULL();
+    glDeleteBuffers(1, &m_blocks);
+  }
+}
+
+bool
+MorphologyScan::init(GLProgramManager* pm, bool dilate)
+{
+  for (int packed = 0; packed < 2; ++packed) {
+    std::string defines =
+      dilate ? "#define COMBINE max\n" : "#define COMBINE min\n";
+    if (packed) {
+      defines += "#define PACKED\n";
+    }
+    Scan& scan = m_scans[packed];
+    scan.program = pm->getProgram(GLProgramManager::MORPHOLOGYSCAN, defines);
+    Combine& combine = m_combines[packed];
+    combine.program =
+      pm->getProgram(GLProgramManager::MORPHOLOGYCOMBINE, defines);
+    if (!scan.program || !combine.program) {
+      return false;
+    }
+    GLint program = scan.program;
+    scan.aCorner = glGetAttribLocation(program, "v_corner");
+    scan.uTexture = glGetUniformLocation(program, "u_texture");
+    scan.uTextureSize = glGetUniformLocation(program, "u_textureSize");
+    scan.uPrevious = glGetUniformLocation(program, "u_previous");
+    scan.uScanSize = glGetUniformLocation(program, "u_scanSize");
+    scan.uAxis = glGetUniformLocation(program, "u_axis");
+    scan.uOffset = glGetUniformLocation(program, "u_offset");
+    scan.uLength = glGetUniformLocation(program, "u_length");
+    scan.uStep = glGetUniformLocation(program, "u_step");
+    scan.uBlockSize = glGetUniformLocation(program, "u_blockSize");
+    scan.uPosition = glGetUniformLocation(program, "u_position");
+    scan.uImageWidth = glGetUniformLocation(program, "u_imageWidth");
+
+    program = combine.program;
+    combine.uForward[0] = glGetUniformLocation(program, "u_forward0");
+    combine.uForward[1] = glGetUniformLocation(program, "u_forward1");
+    combine.uBackward[0] = glGetUniformLocation(program, "u_backward0");
+    combine.uBackward[1] = glGetUniformLocation(program, "u_backward1");
+    combine.uTextureSize = glGetUniformLocation(program, "u_textureSize");
+    combine.uAxis = glGetUniformLocation(program, "u_axis");
+    combine.uKernelSize = glGetUniformLocation(program, "u_kernelSize");
+  }
+  return checkError("MorphologyScan::init");
+}
+
+void
+MorphologyScan::process(const ProcessorInput& pin, GLTexture* source,
+                        MorphologyPlan::Axis axis, GLint size, GLint before,
+                        GLTexture* target)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  bool packed = pin.packed && axis == MorphologyPlan::ROW;
+  GLint along = axis == MorphologyPlan::ROW ? 0 : 1;
+  // the padding lanes of the last texel are scanned like any pixel.
+  GLint pixels = packed ? 4 * pin.width : pin.width;
+  GLint length =
+    (axis == MorphologyPlan::ROW ? pixels : pin.height) + size - 1;
+  // a line per column of the scans, drawn a row at a time.
+  GLint lines = axis == MorphologyPlan::ROW ? pin.height : pin.width;
+  GLfloat axisVector[2] = { 0.0, 0.0 };
+  axisVector[along] = 1.0;
+  GLfloat sourceSize[2] = { static_cast<GLfloat>(pin.width),
+                            static_cast<GLfloat>(pin.height) };
+  GLfloat scanSize[2] = { static_cast<GLfloat>(lines),
+                          static_cast<GLfloat>(length) };
+
+  // the scans cover the whole blocks the windows in the scissor touch.
+  GLint blocks = (length + size - 1) / size;
+  GLint firstBlock = 0, lastBlock = blocks;
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  GLint box[4];
+  glGetIntegerv(GL_SCISSOR_BOX, box);
+  if (scissor) {
+    GLint start = box[along], end = box[along] + box[along + 2];
+    if (packed) {
+      start *= 4;
+      end *= 4;
+    }
+    firstBlock = start / size;
+    lastBlock = std::min(blocks, (end + 2 * size - 2) / size);
+    glScissor(box[1 - along], 0, box[3 - along], length);
+  }
+  glViewport(0, 0, lines, length);
+
+  // the quad of the workflow is put back after the blocks.
+  GLint quad, quadEnabled, quadSize, quadType, quadNormalized, quadStride;
+  GLvoid* quadPointer;
+  const Scan& scan = m_scans[packed];
+  GLuint attribute = scan.aCorner;
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING,
+                      &quad);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                      &quadEnabled);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_SIZE, &quadSize);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_TYPE, &quadType);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED,
+                      &quadNormalized);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &quadStride);
+  glGetVertexAttribPointerv(attribute, GL_VERTEX_ATTRIB_ARRAY_POINTER,
+                            &quadPointer);
+  prepareBlocks(blocks);
+  glBindBuffer(GL_ARRAY_BUFFER, m_blocks);
+  glVertexAttribPointer(attribute, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(attribute);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source->id());
+  glUseProgram(scan.program);
+  glUniform1i(scan.uTexture, 0);
+  glUniform2fv(scan.uTextureSize, 1, sourceSize);
+  glUniform1i(scan.uPrevious, 1);
+  glUniform2fv(scan.uScanSize, 1, scanSize);
+  glUniform2fv(scan.uAxis, 1, axisVector);
+  // the source is mirrored by the sampler, or by the shader on packed rows.
+  glUniform1f(scan.uOffset, static_cast<GLfloat>(-before));
+  glUniform1f(scan.uLength, static_cast<GLfloat>(length));
+  glUniform1f(scan.uBlockSize, static_cast<GLfloat>(size));
+  if (packed) {
+    glUniform1f(scan.uImageWidth, static_cast<GLfloat>(pin.pixelWidth));
+  }
+
+  // forward then backward, the even and odd positions of a block in
+  // textures of their own so that a draw never reads what it writes.
+  std::shared_ptr<GLTexture> scans[2][2];
+  glActiveTexture(GL_TEXTURE1);
+  for (int direction = 0; direction < 2; ++direction) {
+    for (auto& parity : scans[direction]) {
+      parity = wf->requestTextureForFramebuffer(lines, length, GL_RGBA);
+    }
+    for (GLint i = 0; i < size; ++i) {
+      GLint position = direction ? size - 1 - i : i;
+      wf->bindRenderTarget(scans[direction][position & 1].get());
+      if (i < 2) {
+        CHECK_FRAMEBUFFER_COMPLETE(wf);
+      }
+      glBindTexture(GL_TEXTURE_2D, scans[direction][~position & 1]->id());
+      GLint step = i ? (direction ? -1 : 1) : 0;
+      glUniform1f(scan.uStep, static_cast<GLfloat>(step));
+      glUniform1f(scan.uPosition, static_cast<GLfloat>(position));
+      glDrawArrays(GL_TRIANGLES, 6 * firstBlock,
+                   6 * (lastBlock - firstBlock));
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, quad);
+  glVertexAttribPointer(attribute, quadSize, quadType, quadNormalized,
+                        quadStride, quadPointer);
+  if (!quadEnabled) {
+    glDisableVertexAttribArray(attribute);
+  }
+
+  glViewport(0, 0, pin.width, pin.height);
+  if (scissor) {
+    glScissor(box[0], box[1], box[2], box[3]);
+  }
+  wf->bindRenderTarget(target);
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  const Combine& combine = m_combines[packed];
+  glUseProgram(combine.program);
+  for (int parity = 0; parity < 2; ++parity) {
+    glActiveTexture(GL_TEXTURE0 + parity);
+    glBindTexture(GL_TEXTURE_2D, scans[0][parity]->id());
+    glUniform1i(combine.uForward[parity], parity);
+    glActiveTexture(GL_TEXTURE2 + parity);
+    glBindTexture(GL_TEXTURE_2D, scans[1][parity]->id());
+    glUniform1i(combine.uBackward[parity], 2 + parity);
+  }
+  glUniform2fv(combine.uTextureSize, 1, scanSize);
+  glUniform2fv(combine.uAxis, 1, axisVector);
+  glUniform1f(combine.uKernelSize, static_cast<GLfloat>(size));
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+  checkError("MorphologyScan::process");
+}
+
+void
+MorphologyScan::prepareBlocks(GLint blocks)
+{
+  if (blocks <= m_blockCount) {
+    return;
+  }
+  m_blockCount = blocks;
+  static const GLfloat s_corners[6][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 },
+                                           { 0, 1 }, { 1, 0 }, { 1, 1 } };
+  std::vector<GLfloat> corners;
+  corners.reserve(18 * blocks);
+  for (GLint b = 0; b < blocks; ++b) {
+    for (const auto& corner : s_corners) {
+      corners.push_back(static_cast<GLfloat>(b));
+      corners.push_back(corner[0]);
+      corners.push_back(corner[1]);
+    }
+  }
+  if (!m_blocks) {
+    glGenBuffers(1, &m_blocks);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_blocks);
+  glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(GLfloat),
+               corners.data(), GL_STATIC_DRAW);
+}
@@ -0,0 +1,67 @@
+#ifndef MORPHOLOGYSCAN_H
+#define MORPHOLOGYSCAN_H
+#include "MorphologyPlan.h"
+
+class GLProgramManager;
+class GLTexture;
+
+// The maximum or minimum over a window of size pixels along rows or
+// columns in O(1) per pixel (van Herk/Gil-Werman). Each line, extended by
+// mirroring, is cut into blocks of size pixels; a forward and a backward
+// scan combine the pixels from the start of their block and up to its
+// end. A scan draws one position of every block at a time, each taking
+// its pixel and the position the draw before wrote, 2 fetches per pixel
+// in size draws. A window then spans at most two blocks, and is the
+// combination of the backward scan at its first pixel with the forward
+// scan at its last one.
+class MorphologyScan final
+{
+public:
+  MorphologyScan();
+  ~MorphologyScan();
+  // dilate takes the maximum, otherwise the minimum.
+  bool init(GLProgramManager* pm, bool dilate);
+  // renders into target the window of size pixels starting before pixels
+  // ahead of each pixel of source, which is pin.width x pin.height. with
+  // pin.packed, a ROW window runs over the pixels of the packed texels, a
+  // COLUMN one over the texels as they are.
+  void process(const ProcessorInput& pin, GLTexture* source,
+               MorphologyPlan::Axis axis, GLint size, GLint before,
+               GLTexture* target);
+
+private:
+  void prepareBlocks(GLint blocks);
+
+  // the programs reading unpacked and packed rows.
+  struct Scan
+  {
+    GLint program;
+    GLint aCorner;
+    GLint uTexture;
+    GLint uTextureSize;
+    GLint uPrevious;
+    GLint uScanSize;
+    GLint uAxis;
+    GLint uOffset;
+    GLint uLength;
+    GLint uStep;
+    GLint uBlockSize;
+    GLint uPosition;
+    GLint uImageWidth;
+  };
+  struct Combine
+  {
+    GLint program;
+    GLint uForward[2];
+    GLint uBackward[2];
+    GLint uTextureSize;
+    GLint uAxis;
+    GLint uKernelSize;
+  };
+  Scan m_scans[2];
+  Combine m_combines[2];
+  // the corners of a quad per block, 6 vertices each.
+  GLuint m_blocks;
+  GLint m_blockCount;
+};
+#endif /* MORPHOLOGYSCAN_H */
@@ -0,0 +1,352 @@
+#include "OtsuThresholdProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <vector>
+
+// points per band, a band being whole rows of the image.
+static const GLint s_bandPoints = 65536;
+// cells per chunk of rows at most, each summed by the reduce pass in a
+// loop of its own, which drivers may cut short when too long. a chunk then
+// counts less than 2^24 pixels, exact in highp floats.
+static const GLint s_chunkCells = 16384;
+
+OtsuThresholdProcessor::OtsuThresholdProcessor()
+  : m_aPositionScatter(0)
+  , m_uTextureScatter(0)
+  , m_uTextureSizeScatter(0)
+  , m_uPixelsPerTexelScatter(0)
+  , m_uBandStartScatter(0)
+  , m_uChunkStartScatter(0)
+  , m_uRunsPerRowScatter(0)
+  , m_uCellsPerRowScatter(0)
+  , m_uHistogramSizeScatter(0)
+  , m_programScatter(0)
+
+  , m_uHistogramReduce(0)
+  , m_uPreviousReduce(0)
+  , m_uHistogramSizeReduce(0)
+  , m_uCellsPerRowReduce(0)
+  , m_uRowsReduce(0)
+  , m_programReduce(0)
+
+  , m_uHistogramOtsu(0)
+  , m_programOtsu(0)
+
+  , m_uTextureThreshold(0)
+  , m_uThresholdThreshold(0)
+  , m_uTextureSizeThreshold(0)
+  , m_uMaxValueThreshold(0)
+  , m_programThreshold(0)
+
+  , m_uTextureThresholdPacked(0)
+  , m_uThresholdThresholdPacked(0)
+  , m_uTextureSizeThresholdPacked(0)
+  , m_uMaxValueThresholdPacked(0)
+  , m_programThresholdPacked(0)
+
+  , m_band(0)
+  , m_bandWidth(0)
+  , m_bandRows(0)
+  , m_maxTextureSize(0)
+  , m_maxCellsPerRow(0)
+  , m_maxValue(0)
+  , m_selection(OTSU_SELECT_ON_GPU)
+  , m_threshold(0)
+{
+}
+
+OtsuThresholdProcessor::~OtsuThresholdProcessor()
+{
+  if (m_band) {
+    CHECK_CONTEXT_NOT_NULL();
+    glDeleteBuffers(1, &m_band);
+  }
+}
+
+bool
+OtsuThresholdProcessor::init(GLProgramManager* pm, int maxValue,
+                             Selection selection)
+{
+  m_maxValue = maxValue;
+  m_selection = selection;
+  GLint vertexTextureUnits = 0;
+  glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertexTextureUnits);
+  if (!vertexTextureUnits) {
+    GLIMPROC_LOGE("the histogram needs vertex texture fetch.\n");
+    return false;
+  }
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+  m_maxCellsPerRow = m_maxTextureSize / 256;
+
+  m_programScatter = pm->getProgram(GLProgramManager::HISTOGRAMSCATTER);
+  m_programReduce = pm->getProgram(GLProgramManager::HISTOGRAMREDUCE);
+  m_programOtsu = pm->getProgram(GLProgramManager::OTSU);
+  m_programThreshold = pm->getProgram(GLProgramManager::OTSUTHRESHOLD, "");
+  m_programThresholdPacked =
+    pm->getProgram(GLProgramManager::OTSUTHRESHOLD, "#define PACKED\n");
+  if (!m_programScatter || !m_programReduce || !m_programOtsu ||
+      !m_programThreshold || !m_programThresholdPacked) {
+    return false;
+  }
+  GLint program = m_programScatter;
+  m_aPositionScatter = glGetAttribLocation(program, "v_position");
+  m_uTextureScatter = glGetUniformLocation(program, "u_texture");
+  m_uTextureSizeScatter = glGetUniformLocation(program, "u_textureSize");
+  m_uPixelsPerTexelScatter =
+    glGetUniformLocation(program, "u_pixelsPerTexel");
+  m_uBandStartScatter = glGetUniformLocation(program, "u_bandStart");
+  m_uChunkStartScatter = glGetUniformLocation(program, "u_chunkStart");
+  m_uRunsPerRowScatter = glGetUniformLocation(program, "u_runsPerRow");
+  m_uCellsPerRowScatter = glGetUniformLocation(program, "u_cellsPerRow");
+  m_uHistogramSizeScatter = glGetUniformLocation(program, "u_histogramSize");
+
+  program = m_programReduce;
+  m_uHistogramReduce = glGetUniformLocation(program, "u_histogram");
+  m_uPreviousReduce = glGetUniformLocation(program, "u_previous");
+  m_uHistogramSizeReduce = glGetUniformLocation(program, "u_histogramSize");
+  m_uCellsPerRowReduce = glGetUniformLocation(program, "u_cellsPerRow");
+  m_uRowsReduce = glGetUniformLocation(program, "u_rows");
+
+  program = m_programOtsu;
+  m_uHistogramOtsu = glGetUniformLocation(program, "u_histogram");
+
+  program = m_programThreshold;
+  m_uTextureThreshold = glGetUniformLocation(program, "u_texture");
+  m_uThresholdThreshold = glGetUniformLocation(program, "u_threshold");
+  m_uTextureSizeThreshold = glGetUniformLocation(program, "u_textureSize");
+  m_uMaxValueThreshold = glGetUniformLocation(program, "u_maxValue");
+
+  program = m_programThresholdPacked;
+  m_uTextureThresholdPacked = glGetUniformLocation(program, "u_texture");
+  m_uThresholdThresholdPacked = glGetUniformLocation(program, "u_threshold");
+  m_uTextureSizeThresholdPacked =
+    glGetUniformLocation(program, "u_textureSize");
+  m_uMaxValueThresholdPacked = glGetUniformLocation(program, "u_maxValue");
+  return checkError("OtsuThresholdProcessor::init");
+}
+
+ProcessorFootprint
+OtsuThresholdProcessor::footprint() const
+{
+  return ProcessorFootprint{ s_wholeImageFootprint, s_wholeImageFootprint,
+                             s_wholeImageFootprint, s_wholeImageFootprint };
+}
+
+ProcessorOutput
+OtsuThresholdProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLint pixelWidth = pin.packed ? pin.pixelWidth : pin.width;
+  GLint runsPerRow = (pixelWidth + 254) / 255;
+  // the cells of a chunk fit in a texture.
+  GLint chunkRows =
+    std::min(m_maxCellsPerRow * m_maxTextureSize, s_chunkCells) / runsPerRow;
+  chunkRows = std::max(1, std::min(chunkRows, pin.height));
+  GLint cells = runsPerRow * chunkRows;
+  GLint cellsPerRow = std::min(cells, m_maxCellsPerRow);
+  GLint rows = (cells + cellsPerRow - 1) / cellsPerRow;
+  GLfloat histogramSize[2] = { static_cast<GLfloat>(256 * cellsPerRow),
+                               static_cast<GLfloat>(rows) };
+  GLfloat textureSize[2] = { static_cast<GLfloat>(pin.width),
+                             static_cast<GLfloat>(pin.height) };
+  std::shared_ptr<GLTexture> histogram =
+    wf->requestTextureForFramebuffer(256 * cellsPerRow, rows, GL_RGBA);
+  std::shared_ptr<GLTexture> counts[2] = {
+    wf->requestTextureForFramebuffer(256, 1, GL_RGBA),
+    wf->requestTextureForFramebuffer(256, 1, GL_RGBA)
+  };
+  std::shared_ptr<GLTexture> threshold =
+    wf->requestTextureForFramebuffer(1, 1, GL_RGBA);
+  std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+
+  // every pixel counts, whatever the scissor.
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  size_t current = 0;
+  wf->bindRenderTarget(counts[current].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // the quad of the workflow is put back after the points.
+  GLint quad, quadEnabled, quadSize, quadType, quadNormalized, quadStride;
+  GLvoid* quadPointer;
+  GLuint attribute = m_aPositionScatter;
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING,
+                      &quad);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+                      &quadEnabled);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_SIZE, &quadSize);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_TYPE, &quadType);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED,
+                      &quadNormalized);
+  glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &quadStride);
+  glGetVertexAttribPointerv(attribute, GL_VERTEX_ATTRIB_ARRAY_POINTER,
+                            &quadPointer);
+  prepareBand(pixelWidth);
+
+  for (GLint chunk = 0; chunk < pin.height; chunk += chunkRows) {
+    GLint chunkEnd = std::min(pin.height, chunk + chunkRows);
+    wf->bindRenderTarget(histogram.get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glViewport(0, 0, 256 * cellsPerRow, rows);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, m_band);
+    glVertexAttribPointer(attribute, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(attribute);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pin.color->id());
+    glUseProgram(m_programScatter);
+    glUniform1i(m_uTextureScatter, 0);
+    glUniform2fv(m_uTextureSizeScatter, 1, textureSize);
+    glUniform1f(m_uPixelsPerTexelScatter, pin.packed ? 4.0f : 1.0f);
+    glUniform1f(m_uChunkStartScatter, static_cast<GLfloat>(chunk));
+    glUniform1f(m_uRunsPerRowScatter, static_cast<GLfloat>(runsPerRow));
+    glUniform1f(m_uCellsPerRowScatter, static_cast<GLfloat>(cellsPerRow));
+    glUniform2fv(m_uHistogramSizeScatter, 1, histogramSize);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (GLint start = chunk; start < chunkEnd; start += m_bandRows) {
+      GLint bandRows = std::min(m_bandRows, chunkEnd - start);
+      glUniform1f(m_uBandStartScatter, static_cast<GLfloat>(start));
+      glDrawArrays(GL_POINTS, 0, pixelWidth * bandRows);
+    }
+    glDisable(GL_BLEND);
+    glBindBuffer(GL_ARRAY_BUFFER, quad);
+    glVertexAttribPointer(attribute, quadSize, quadType, quadNormalized,
+                          quadStride, quadPointer);
+    if (!quadEnabled) {
+      glDisableVertexAttribArray(attribute);
+    }
+
+    wf->bindRenderTarget(counts[current ^ 1].get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glViewport(0, 0, 256, 1);
+    glBindTexture(GL_TEXTURE_2D, histogram->id());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, counts[current]->id());
+    glUseProgram(m_programReduce);
+    glUniform1i(m_uHistogramReduce, 0);
+    glUniform1i(m_uPreviousReduce, 1);
+    glUniform2fv(m_uHistogramSizeReduce, 1, histogramSize);
+    glUniform1i(m_uCellsPerRowReduce, cellsPerRow);
+    glUniform1i(m_uRowsReduce, rows);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glActiveTexture(GL_TEXTURE0);
+    current ^= 1;
+  }
+
+  if (m_selection == OTSU_SELECT_ON_CPU) {
+    uint8_t digits[256 * 4];
+    uint32_t bins[256];
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, digits);
+    for (size_t i = 0; i < 256; ++i) {
+      const uint8_t* d = digits + 4 * i;
+      bins[i] = d[0] | d[1] << 8 | d[2] << 16 | static_cast<uint32_t>(d[3])
+                                                  << 24;
+    }
+    m_threshold = selectThreshold(bins);
+    uint8_t texel[4] = { static_cast<uint8_t>(m_threshold),
+                         static_cast<uint8_t>(m_threshold),
+                         static_cast<uint8_t>(m_threshold),
+                         static_cast<uint8_t>(m_threshold) };
+    glBindTexture(GL_TEXTURE_2D, threshold->id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    texel);
+  } else {
+    wf->bindRenderTarget(threshold.get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glViewport(0, 0, 1, 1);
+    glBindTexture(GL_TEXTURE_2D, counts[current]->id());
+    glUseProgram(m_programOtsu);
+    glUniform1i(m_uHistogramOtsu, 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  glViewport(0, 0, pin.width, pin.height);
+  if (scissor) {
+    glEnable(GL_SCISSOR_TEST);
+  }
+  wf->bindRenderTarget(target.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLfloat maxValue = static_cast<GLfloat>(m_maxValue) / 255.0f;
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, threshold->id());
+  if (pin.packed) {
+    glUseProgram(m_programThresholdPacked);
+    glUniform1i(m_uTextureThresholdPacked, 0);
+    glUniform1i(m_uThresholdThresholdPacked, 1);
+    glUniform2fv(m_uTextureSizeThresholdPacked, 1, textureSize);
+    glUniform1f(m_uMaxValueThresholdPacked, maxValue);
+  } else {
+    glUseProgram(m_programThreshold);
+    glUniform1i(m_uTextureThreshold, 0);
+    glUniform1i(m_uThresholdThreshold, 1);
+    glUniform2fv(m_uTextureSizeThreshold, 1, textureSize);
+    glUniform1f(m_uMaxValueThreshold, maxValue);
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+  checkError("OtsuThresholdProcessor::process");
+  return ProcessorOutput{ target };
+}
+
+int
+OtsuThresholdProcessor::selectThreshold(const uint32_t histogram[256])
+{
+  double total = 0.0, sum = 0.0;
+  for (int i = 0; i < 256; ++i) {
+    total += histogram[i];
+    sum += static_cast<double>(i) * histogram[i];
+  }
+  double below = 0.0, sumBelow = 0.0, best = -1.0;
+  int threshold = 0;
+  for (int i = 0; i < 256; ++i) {
+    below += histogram[i];
+    sumBelow += static_cast<double>(i) * histogram[i];
+    double above = total - below;
+    if (below == 0.0 || above == 0.0) {
+      continue;
+    }
+    double d = sumBelow / below - (sum - sumBelow) / above;
+    double between = below * above * d * d;
+    if (between > best) {
+      best = between;
+      threshold = i;
+    }
+  }
+  return threshold;
+}
+
+void
+OtsuThresholdProcessor::prepareBand(GLint width)
+{
+  if (width == m_bandWidth) {
+    return;
+  }
+  m_bandWidth = width;
+  m_bandRows = std::max(1, s_bandPoints / width);
+  std::vector<GLfloat> points;
+  points.reserve(2 * width * m_bandRows);
+  for (GLint y = 0; y < m_bandRows; ++y) {
+    for (GLint x = 0; x < width; ++x) {
+      points.push_back(static_cast<GLfloat>(x));
+      points.push_back(static_cast<GLfloat>(y));
+    }
+  }
+  if (!m_band) {
+    glGenBuffers(1, &m_band);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_band);
+  glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(GLfloat),
+               points.data(), GL_STATIC_DRAW);
+}
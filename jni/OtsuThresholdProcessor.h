@@ -0,0 +1,86 @@
+#ifndef OTSUTHRESHOLDPROCESSOR_H
+#define OTSUTHRESHOLDPROCESSOR_H
+#include "IImageProcessor.h"
+#include <stdint.h>
+
+class GLProgramManager;
+
+// maxValue where the red channel is above the threshold Otsu's method
+// picks for the image, else zero. The 256 bin histogram is built on the
+// GPU: one point per pixel is drawn onto the bin of its value and counted
+// by additive blending into 8 bit texels, each run of at most 255 pixels
+// of a row in cells of its own, which a second pass sums up. Rows are
+// counted in chunks of a bounded number of cells, each chunk added to the
+// counts of those before. The threshold is global: the footprint spans
+// the whole image, so images are never tiled and regions of interest are
+// thresholded with the histogram of every pixel.
+class OtsuThresholdProcessor final : public IImageProcessor
+{
+public:
+  enum Selection
+  {
+    // the threshold never leaves the GPU.
+    OTSU_SELECT_ON_GPU,
+    // the 256 counts are read back and the threshold is picked on the CPU,
+    // see threshold().
+    OTSU_SELECT_ON_CPU,
+  };
+  OtsuThresholdProcessor();
+  ~OtsuThresholdProcessor();
+  // needs vertex texture fetch.
+  bool init(GLProgramManager* pm, int maxValue,
+            Selection selection = OTSU_SELECT_ON_GPU);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  bool supportsPackedLuma() const override { return true; }
+  // the threshold of the last image with OTSU_SELECT_ON_CPU.
+  int threshold() const { return m_threshold; }
+  // pixels above the returned bin go to maxValue.
+  static int selectThreshold(const uint32_t histogram[256]);
+
+private:
+  // the points of a band of rows of width pixels, the same for every band.
+  void prepareBand(GLint width);
+  GLint m_aPositionScatter;
+  GLint m_uTextureScatter;
+  GLint m_uTextureSizeScatter;
+  GLint m_uPixelsPerTexelScatter;
+  GLint m_uBandStartScatter;
+  GLint m_uChunkStartScatter;
+  GLint m_uRunsPerRowScatter;
+  GLint m_uCellsPerRowScatter;
+  GLint m_uHistogramSizeScatter;
+  GLint m_programScatter;
+
+  GLint m_uHistogramReduce;
+  GLint m_uPreviousReduce;
+  GLint m_uHistogramSizeReduce;
+  GLint m_uCellsPerRowReduce;
+  GLint m_uRowsReduce;
+  GLint m_programReduce;
+
+  GLint m_uHistogramOtsu;
+  GLint m_programOtsu;
+
+  GLint m_uTextureThreshold;
+  GLint m_uThresholdThreshold;
+  GLint m_uTextureSizeThreshold;
+  GLint m_uMaxValueThreshold;
+  GLint m_programThreshold;
+
+  GLint m_uTextureThresholdPacked;
+  GLint m_uThresholdThresholdPacked;
+  GLint m_uTextureSizeThresholdPacked;
+  GLint m_uMaxValueThresholdPacked;
+  GLint m_programThresholdPacked;
+
+  GLuint m_band;
+  GLint m_bandWidth;
+  GLint m_bandRows;
+  GLint m_maxTextureSize;
+  GLint m_maxCellsPerRow;
+  int m_maxValue;
+  Selection m_selection;
+  int m_threshold;
+};
+#endif /* OTSUTHRESHOLDPROCESSOR_H */
@@ -0,0 +1,75 @@
+#include "PackProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdlib.h>
+
+PackProcessor::PackProcessor()
+  : m_packing(PACK_GRAY)
+  , m_pixelsPerTexel(4)
+  , m_uTexture(0)
+  , m_uScreenGeometry(0)
+  , m_program(0)
+{
+}
+
+bool
+PackProcessor::init(GLProgramManager* pm, Packing packing)
+{
+  m_packing = packing;
+  m_pixelsPerTexel = packing == PACK_BINARY ? 32 : 4;
+  switch (packing) {
+    case PACK_GRAY:
+      m_program = pm->getProgram(GLProgramManager::PACKGRAY);
+      break;
+    case PACK_BINARY:
+      m_program = pm->getProgram(GLProgramManager::PACKBINARY);
+      break;
+    case UNPACK_GRAY:
+      m_program = pm->getProgram(GLProgramManager::UNPACKGRAY);
+      break;
+  }
+  if (!m_program)
+    return false;
+  GLint program = m_program;
+  m_uTexture = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometry = glGetUniformLocation(program, "u_screenGeometry");
+  GLIMPROC_LOGI("m_uTexture: %d, m_uScreenGeometry: %d.\n", m_uTexture,
+                m_uScreenGeometry);
+  return true;
+}
+
+GLint
+PackProcessor::packedWidth(GLint width, GLint pixelsPerTexel)
+{
+  return (width + pixelsPerTexel - 1) / pixelsPerTexel;
+}
+
+ProcessorOutput
+PackProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLint width = m_packing == UNPACK_GRAY
+                  ? pin.pixelWidth
+                  : packedWidth(pin.width, m_pixelsPerTexel);
+  std::shared_ptr<GLTexture> tmpTexture[1] = {
+    wf->requestTextureForFramebuffer(width, pin.height, GL_RGBA)
+  };
+
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
+  glViewport(0, 0, width, pin.height);
+  glUseProgram(m_program);
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  glUniform1i(m_uTexture, 0);
+
+  glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glViewport(0, 0, pin.width, pin.height);
+  return ProcessorOutput{ tmpTexture[0] };
+}
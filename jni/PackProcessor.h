@@ -0,0 +1,40 @@
+#ifndef PACKPROCESSOR_H
+#define PACKPROCESSOR_H
+#include "IImageProcessor.h"
+
+class GLProgramManager;
+
+// Moves the pixels of a row between one per texel and several packed into
+// one RGBA texel.
+class PackProcessor final : public IImageProcessor
+{
+public:
+  enum Packing
+  {
+    // the red channel of four horizontally adjacent pixels in one texel.
+    PACK_GRAY,
+    // 32 horizontally adjacent binary pixels in one texel, one bit per
+    // pixel, set where the red channel is nonzero. the leftmost pixel goes
+    // to the most significant bit of the first byte, and bits past the
+    // image width are zero.
+    PACK_BINARY,
+    // the inverse of PACK_GRAY: spreads the four pixels of each texel back
+    // over pin.pixelWidth pixels, every channel holding the gray value.
+    UNPACK_GRAY,
+  };
+  PackProcessor();
+  ~PackProcessor() = default;
+  bool init(GLProgramManager* pm, Packing packing);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  // the texels of a row of width pixels packed pixelsPerTexel to a texel.
+  static GLint packedWidth(GLint width, GLint pixelsPerTexel);
+
+private:
+  Packing m_packing;
+  GLint m_pixelsPerTexel;
+  GLint m_uTexture;
+  GLint m_uScreenGeometry;
+  GLint m_program;
+};
+
+#endif /* PACKPROCESSOR_H */
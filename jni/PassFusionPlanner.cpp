@@ -0,0 +1,161 @@
+#include "PassFusionPlanner.h"
+#include <algorithm>
+#include <limits>
+
+// taps a fused pass may sample per pixel.
+static const unsigned s_maxFusedTaps = 64;
+// cost of writing and reading back one full-screen intermediate, in taps.
+static const unsigned s_passCost = 32;
+
+unsigned
+FusedPass::taps() const
+{
+  unsigned taps = 1;
+  for (auto& line : lines) {
+    taps *= line.size;
+  }
+  return taps;
+}
+
+ProcessorFootprint
+FusedPass::footprint() const
+{
+  ProcessorFootprint f = { 0, 0, 0, 0 };
+  for (auto& point : points) {
+    f.left += std::max(0, -point.offsetX);
+    f.right += std::max(0, point.offsetX);
+    f.bottom += std::max(0, -point.offsetY);
+    f.top += std::max(0, point.offsetY);
+  }
+  for (auto& line : lines) {
+    GLint size = line.size;
+    if (line.axis == ROW) {
+      f.left += size / 2;
+      f.right += size - 1 - size / 2;
+    } else {
+      f.bottom += size - 1 - size / 2;
+      f.top += size / 2;
+    }
+  }
+  return f;
+}
+
+PassFusionPlanner::PassFusionPlanner()
+  : m_maxTaps(s_maxFusedTaps)
+  , m_passCost(s_passCost)
+{
+}
+
+std::vector<FusedPass>
+PassFusionPlanner::lower(const std::vector<ProcessorDescription>& descs)
+{
+  std::vector<FusedPass> primitives;
+  for (auto& desc : descs) {
+    FusedPass pass;
+    switch (desc.kind) {
+      case ProcessorDescription::THRESHOLD:
+        pass.points.push_back(desc);
+        primitives.push_back(pass);
+        break;
+      case ProcessorDescription::DILATE_NONZERO:
+      case ProcessorDescription::ERODE_NONZERO: {
+        FusedPass::LineOp op = FusedPass::MIN;
+        if (desc.kind == ProcessorDescription::DILATE_NONZERO) {
+          op = FusedPass::MAX;
+        }
+        FusedPass::Line line = { op, FusedPass::ROW, desc.kwidth };
+        pass.lines.push_back(line);
+        primitives.push_back(pass);
+        pass.lines[0].axis = FusedPass::COLUMN;
+        pass.lines[0].size = desc.kheight;
+        primitives.push_back(pass);
+        break;
+      }
+    }
+  }
+  return primitives;
+}
+
+unsigned
+PassFusionPlanner::unfusedPassCount(
+  const std::vector<ProcessorDescription>& descs)
+{
+  return lower(descs).size();
+}
+
+bool
+PassFusionPlanner::canFuse(const std::vector<FusedPass>& primitives,
+                           size_t begin, size_t end, FusedPass* fused) const
+{
+  FusedPass pass;
+  for (size_t i = begin; i < end; ++i) {
+    const FusedPass& primitive = primitives[i];
+    // a point operation can only be folded into the sampling of a line,
+    // not applied to its result.
+    if (!primitive.points.empty() && !pass.lines.empty()) {
+      return false;
+    }
+    pass.points.insert(pass.points.end(), primitive.points.begin(),
+                       primitive.points.end());
+    pass.lines.insert(pass.lines.end(), primitive.lines.begin(),
+                      primitive.lines.end());
+  }
+  // a single primitive always makes a pass on its own.
+  if (end - begin > 1 && (pass.lines.size() > 2 || pass.taps() > m_maxTaps)) {
+    return false;
+  }
+  *fused = pass;
+  return true;
+}
+
+std::vector<FusedPass>
+PassFusionPlanner::plan(const std::vector<ProcessorDescription>& descs) const
+{
+  std::vector<FusedPass> primitives = lower(descs);
+  size_t n = primitives.size();
+  // cheapest split of primitives[0, i) into passes, and where its last
+  // pass begins.
+  std::vector<unsigned> cost(n + 1, std::numeric_limits<unsigned>::max());
+  std::vector<size_t> split(n + 1, 0);
+  cost[0] = 0;
+  for (size_t end = 1; end <= n; ++end) {
+    for (size_t begin = 0; begin < end; ++begin) {
+      FusedPass pass;
+      if (!canFuse(primitives, begin, end, &pass)) {
+        continue;
+      }
+      unsigned c = cost[begin] + m_passCost + pass.taps();
+      if (c < cost[end]) {
+        cost[end] = c;
+        split[end] = begin;
+      }
+    }
+  }
+  std::vector<FusedPass> passes;
+  for (size_t end = n; end > 0; end = split[end]) {
+    FusedPass pass;
+    canFuse(primitives, split[end], end, &pass);
+    passes.insert(passes.begin(), pass);
+  }
+  return passes;
+}
+
+void
+PassFusionPlanner::dump(const std::vector<FusedPass>& passes)
+{
+  static const char* s_ops[] = { "max", "min" };
+  static const char* s_axes[] = { "row", "column" };
+  for (size_t i = 0; i < passes.size(); ++i) {
+    const FusedPass& pass = passes[i];
+    GLIMPROC_LOGI("fused pass %zu: %u taps.\n", i, pass.taps());
+    for (auto& point : pass.points) {
+      GLIMPROC_LOGI("  threshold %d -> %d at offset (%d, %d).\n",
+                    point.threshold, point.maxValue, point.offsetX,
+                    point.offsetY);
+    }
+    for (auto& line : pass.lines) {
+      GLIMPROC_LOGI("  %s %s of %u.\n", s_ops[line.op], s_axes[line.axis],
+                    line.size);
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef PASSFUSIONPLANNER_H
+#define PASSFUSIONPLANNER_H
+#include "IImageProcessor.h"
+#include <vector>
+
+// One full-screen pass of a fused plan. Every tap samples the pass input
+// through the point operations in order, then the line reductions are
+// applied in order, the first one innermost.
+struct FusedPass
+{
+  enum LineOp
+  {
+    MAX,
+    MIN,
+  };
+  enum Axis
+  {
+    ROW,
+    COLUMN,
+  };
+  struct Line
+  {
+    LineOp op;
+    Axis axis;
+    unsigned size;
+  };
+  std::vector<ProcessorDescription> points;
+  std::vector<Line> lines;
+  unsigned taps() const;
+  ProcessorFootprint footprint() const;
+};
+
+// Lowers described processors to point and line primitives and groups
+// adjacent primitives into as few passes as the tap budget allows.
+class PassFusionPlanner final
+{
+public:
+  PassFusionPlanner();
+  std::vector<FusedPass> plan(
+    const std::vector<ProcessorDescription>& descs) const;
+  static void dump(const std::vector<FusedPass>& passes);
+  // primitive passes the descriptions would take without fusion.
+  static unsigned unfusedPassCount(
+    const std::vector<ProcessorDescription>& descs);
+
+private:
+  static std::vector<FusedPass> lower(
+    const std::vector<ProcessorDescription>& descs);
+  bool canFuse(const std::vector<FusedPass>& primitives, size_t begin,
+               size_t end, FusedPass* fused) const;
+  unsigned m_maxTaps;
+  unsigned m_passCost;
+};
+#endif /* PASSFUSIONPLANNER_H */
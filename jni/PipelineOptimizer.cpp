@@ -0,0 +1,142 @@
+#include "PipelineOptimizer.h"
+#include "DilateNonZeroProcessor.h"
+#include "ErodeNonZeroProcessor.h"
+#include "ThresholdProcessor.h"
+#include <utility>
+
+bool
+PipelineOptimizer::isMorphology(const ProcessorDescription& desc)
+{
+  return desc.kind == ProcessorDescription::DILATE_NONZERO ||
+         desc.kind == ProcessorDescription::ERODE_NONZERO;
+}
+
+bool
+PipelineOptimizer::isIdentity(const ProcessorDescription& desc)
+{
+  return isMorphology(desc) && desc.kwidth == 1 && desc.kheight == 1;
+}
+
+// Two flat kernels of sizes k1 and k2 compose into one of k1 + k2 - 1.
+// The shaders anchor a kernel at k / 2, so only odd sizes keep the anchor
+// centered and the mirrored border symmetric.
+bool
+PipelineOptimizer::canMerge(const ProcessorDescription& a,
+                            const ProcessorDescription& b)
+{
+  return isMorphology(a) && a.kind == b.kind && (a.kwidth & 1) &&
+         (a.kheight & 1) && (b.kwidth & 1) && (b.kheight & 1);
+}
+
+ProcessorDescription
+PipelineOptimizer::merge(const ProcessorDescription& a,
+                         const ProcessorDescription& b)
+{
+  ProcessorDescription merged = a;
+  merged.kwidth = a.kwidth + b.kwidth - 1;
+  merged.kheight = a.kheight + b.kheight - 1;
+  return merged;
+}
+
+// A threshold only ever outputs zero or its maxValue, so a following
+// threshold at or above that maxValue outputs zero everywhere.
+bool
+PipelineOptimizer::canCancel(const ProcessorDescription& a,
+                             const ProcessorDescription& b)
+{
+  return a.kind == ProcessorDescription::THRESHOLD &&
+         b.kind == ProcessorDescription::THRESHOLD && b.threshold >= 0 &&
+         a.maxValue <= b.threshold;
+}
+
+// A threshold is monotone, so it commutes with max and min. Its sampling
+// offset does not commute with the border mirroring of a kernel along the
+// same axis, which restricts the kernels it can move across.
+bool
+PipelineOptimizer::canCommute(const ProcessorDescription& point,
+                              const ProcessorDescription& morphology)
+{
+  return point.kind == ProcessorDescription::THRESHOLD &&
+         isMorphology(morphology) &&
+         (point.offsetX == 0 || morphology.kwidth == 1) &&
+         (point.offsetY == 0 || morphology.kheight == 1);
+}
+
+bool
+PipelineOptimizer::rewrite(std::vector<ProcessorDescription>* descs) const
+{
+  std::vector<ProcessorDescription>& d = *descs;
+  for (size_t i = 0; i < d.size(); ++i) {
+    if (isIdentity(d[i])) {
+      d.erase(d.begin() + i);
+      return true;
+    }
+  }
+  for (size_t i = 0; i + 1 < d.size(); ++i) {
+    if (canMerge(d[i], d[i + 1])) {
+      d[i] = merge(d[i], d[i + 1]);
+      d.erase(d.begin() + i + 1);
+      return true;
+    }
+    if (canCancel(d[i], d[i + 1])) {
+      d[i + 1].maxValue = 0;
+      d.erase(d.begin() + i);
+      return true;
+    }
+  }
+  // morphology, threshold, morphology: move the threshold out of the way.
+  for (size_t i = 0; i + 2 < d.size(); ++i) {
+    if (!canMerge(d[i], d[i + 2])) {
+      continue;
+    }
+    if (canCommute(d[i + 1], d[i])) {
+      std::swap(d[i], d[i + 1]);
+      return true;
+    }
+    if (canCommute(d[i + 1], d[i + 2])) {
+      std::swap(d[i + 1], d[i + 2]);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<ProcessorDescription>
+PipelineOptimizer::optimize(
+  const std::vector<ProcessorDescription>& descs) const
+{
+  std::vector<ProcessorDescription> optimized(descs);
+  while (rewrite(&optimized)) {
+  }
+  return optimized;
+}
+
+std::unique_ptr<IImageProcessor>
+PipelineOptimizer::createProcessor(GLProgramManager* pm,
+                                   const ProcessorDescription& desc)
+{
+  switch (desc.kind) {
+    case ProcessorDescription::THRESHOLD: {
+      std::unique_ptr<ThresholdProcessor> p(new ThresholdProcessor);
+      if (!p->init(pm, desc.maxValue, desc.threshold)) {
+        return nullptr;
+      }
+      return p;
+    }
+    case ProcessorDescription::DILATE_NONZERO: {
+      std::unique_ptr<DilateNonZeroProcessor> p(new DilateNonZeroProcessor);
+      if (!p->init(pm, desc.kwidth, desc.kheight, 1)) {
+        return nullptr;
+      }
+      return p;
+    }
+    case ProcessorDescription::ERODE_NONZERO: {
+      std::unique_ptr<ErodeNonZeroProcessor> p(new ErodeNonZeroProcessor);
+      if (!p->init(pm, desc.kwidth, desc.kheight, 1)) {
+        return nullptr;
+      }
+      return p;
+    }
+  }
+  return nullptr;
+}
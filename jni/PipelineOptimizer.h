@@ -0,0 +1,36 @@
+#ifndef PIPELINEOPTIMIZER_H
+#define PIPELINEOPTIMIZER_H
+#include "IImageProcessor.h"
+#include <memory>
+#include <vector>
+
+class GLProgramManager;
+
+// Rewrites described processors into a cheaper equivalent sequence:
+// morphology with a 1x1 kernel is dropped, adjacent erodes or dilates are
+// merged into one kernel, a threshold that can only produce zero after
+// another threshold replaces both, and thresholds commute with morphology
+// when that brings two mergeable stages together. Every rewrite is exact,
+// border pixels included.
+class PipelineOptimizer final
+{
+public:
+  std::vector<ProcessorDescription> optimize(
+    const std::vector<ProcessorDescription>& descs) const;
+  static std::unique_ptr<IImageProcessor> createProcessor(
+    GLProgramManager* pm, const ProcessorDescription& desc);
+
+private:
+  static bool isMorphology(const ProcessorDescription& desc);
+  static bool isIdentity(const ProcessorDescription& desc);
+  static bool canMerge(const ProcessorDescription& a,
+                       const ProcessorDescription& b);
+  static ProcessorDescription merge(const ProcessorDescription& a,
+                                    const ProcessorDescription& b);
+  static bool canCancel(const ProcessorDescription& a,
+                        const ProcessorDescription& b);
+  static bool canCommute(const ProcessorDescription& point,
+                         const ProcessorDescription& morphology);
+  bool rewrite(std::vector<ProcessorDescription>* descs) const;
+};
+#endif /* PIPELINEOPTIMIZER_H */
@@ -0,0 +1,147 @@
+#include "ProcessorGraph.h"
+#include <algorithm>
+
+const char* const ProcessorGraph::s_source = "source";
+
+enum VisitState
+{
+  UNVISITED,
+  VISITING,
+  VISITED,
+};
+
+static ProcessorFootprint
+extend(const ProcessorFootprint& a, const ProcessorFootprint& b)
+{
+  return ProcessorFootprint{ a.left + b.left, a.right + b.right,
+                             a.bottom + b.bottom, a.top + b.top };
+}
+
+static ProcessorFootprint
+cover(const ProcessorFootprint& a, const ProcessorFootprint& b)
+{
+  return ProcessorFootprint{ std::max(a.left, b.left),
+                             std::max(a.right, b.right),
+                             std::max(a.bottom, b.bottom),
+                             std::max(a.top, b.top) };
+}
+
+ProcessorGraph::ProcessorGraph()
+  : m_output(s_source)
+{
+}
+
+void
+ProcessorGraph::addNode(IImageProcessor* processor,
+                        std::vector<std::string> inputs, std::string output)
+{
+  m_nodes.push_back(Node{ processor, std::move(inputs), std::move(output) });
+}
+
+void
+ProcessorGraph::setOutput(std::string output)
+{
+  m_output = std::move(output);
+}
+
+bool
+ProcessorGraph::visit(size_t node, const ProducerMap& producers,
+                      std::vector<int>* state,
+                      std::vector<size_t>* order) const
+{
+  (*state)[node] = VISITING;
+  if (m_nodes[node].inputs.empty()) {
+    GLIMPROC_LOGE("node writing %s has no input.\n",
+                  m_nodes[node].output.c_str());
+    return false;
+  }
+  for (auto& input : m_nodes[node].inputs) {
+    if (input == s_source) {
+      continue;
+    }
+    auto found = producers.find(input);
+    if (found == producers.end()) {
+      GLIMPROC_LOGE("no node writes %s.\n", input.c_str());
+      return false;
+    }
+    if ((*state)[found->second] == VISITING) {
+      GLIMPROC_LOGE("%s depends on itself.\n", input.c_str());
+      return false;
+    }
+    if ((*state)[found->second] == UNVISITED &&
+        !visit(found->second, producers, state, order)) {
+      return false;
+    }
+  }
+  (*state)[node] = VISITED;
+  order->push_back(node);
+  return true;
+}
+
+bool
+ProcessorGraph::schedule(std::vector<ProcessorStep>* steps,
+                         size_t* outputSlot,
+                         ProcessorFootprint* footprint) const
+{
+  ProducerMap producers;
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    const std::string& image = m_nodes[i].output;
+    if (image == s_source || !producers.insert({ image, i }).second) {
+      GLIMPROC_LOGE("%s is written more than once.\n", image.c_str());
+      return false;
+    }
+  }
+  // nodes the output does not depend on are left out.
+  std::vector<size_t> order;
+  std::vector<int> state(m_nodes.size(), UNVISITED);
+  if (m_output != s_source) {
+    auto found = producers.find(m_output);
+    if (found == producers.end()) {
+      GLIMPROC_LOGE("no node writes %s.\n", m_output.c_str());
+      return false;
+    }
+    if (!visit(found->second, producers, &state, &order)) {
+      return false;
+    }
+  }
+
+  std::unordered_map<std::string, size_t> slots;
+  slots[s_source] = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    slots[m_nodes[order[i]].output] = i + 1;
+  }
+  steps->clear();
+  std::vector<size_t> lastReader(order.size() + 1, order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    const Node& node = m_nodes[order[i]];
+    ProcessorStep step;
+    step.processor = node.processor;
+    for (auto& input : node.inputs) {
+      size_t slot = slots[input];
+      step.inputs.push_back(slot);
+      lastReader[slot] = i;
+    }
+    step.output = i + 1;
+    steps->push_back(step);
+  }
+  *outputSlot = slots[m_output];
+  for (size_t slot = 0; slot < lastReader.size(); ++slot) {
+    if (slot != *outputSlot && lastReader[slot] != order.size()) {
+      (*steps)[lastReader[slot]].releases.push_back(slot);
+    }
+  }
+  // the widest reach over the consumers of each slot, walking back from
+  // the output.
+  ProcessorFootprint none = { 0, 0, 0, 0 };
+  std::vector<ProcessorFootprint> consumers(order.size() + 1, none);
+  for (size_t i = steps->size(); i-- > 0;) {
+    ProcessorStep& step = (*steps)[i];
+    step.reach =
+      extend(step.processor->footprint(), consumers[step.output]);
+    for (size_t slot : step.inputs) {
+      consumers[slot] = cover(consumers[slot], step.reach);
+    }
+  }
+  *footprint = consumers[0];
+  return true;
+}
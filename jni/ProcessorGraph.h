@@ -0,0 +1,54 @@
+#ifndef PROCESSORGRAPH_H
+#define PROCESSORGRAPH_H
+#include "IImageProcessor.h"
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One node of a scheduled graph. Images live in numbered slots, slot 0
+// being the image handed to the workflow.
+struct ProcessorStep
+{
+  IImageProcessor* processor;
+  std::vector<size_t> inputs;
+  size_t output;
+  // slots this step is the last reader of.
+  std::vector<size_t> releases;
+  // what this step and the steps after it read around an output pixel.
+  ProcessorFootprint reach;
+};
+
+// Processors wired by image names. A node reads the images named by its
+// inputs and writes the image named by its output; an image read by
+// several nodes is computed once and shared.
+class ProcessorGraph final
+{
+public:
+  // the name of the image handed to the workflow.
+  static const char* const s_source;
+  ProcessorGraph();
+  void addNode(IImageProcessor* processor, std::vector<std::string> inputs,
+               std::string output);
+  // the image the workflow reads back.
+  void setOutput(std::string output);
+  // orders the nodes the output depends on so that every node runs after
+  // the producers of its inputs. fails on an image without producer or
+  // with several, and on a cycle.
+  bool schedule(std::vector<ProcessorStep>* steps, size_t* outputSlot,
+                ProcessorFootprint* footprint) const;
+
+private:
+  struct Node
+  {
+    IImageProcessor* processor;
+    std::vector<std::string> inputs;
+    std::string output;
+  };
+  typedef std::unordered_map<std::string, size_t> ProducerMap;
+  bool visit(size_t node, const ProducerMap& producers,
+             std::vector<int>* state, std::vector<size_t>* order) const;
+  std::vector<Node> m_nodes;
+  std::string m_output;
+};
+#endif /* PROCESSORGRAPH_H */
@@ -0,0 +1,136 @@
+#include "SauvolaThresholdProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdlib.h>
+
+// 257^2 squares of 255 still fit 32 bits.
+static const int s_maxBlockSize = 257;
+
+SauvolaThresholdProcessor::SauvolaThresholdProcessor()
+  : m_maxValue(0)
+  , m_blockSize(0)
+  , m_k(0.0f)
+  , m_r(0.0f)
+  , m_uTexture(0)
+  , m_uTable(0)
+  , m_uBlockSize(0)
+  , m_uMaxValue(0)
+  , m_uK(0)
+  , m_uR(0)
+  , m_program(0)
+  , m_uTexturePacked(0)
+  , m_uTablePacked(0)
+  , m_uBlockSizePacked(0)
+  , m_uPixelWidthPacked(0)
+  , m_uMaxValuePacked(0)
+  , m_uKPacked(0)
+  , m_uRPacked(0)
+  , m_programPacked(0)
+{
+}
+
+bool
+SauvolaThresholdProcessor::init(GLProgramManager* pm, int maxValue,
+                                Method method, int blockSize, double k,
+                                double r)
+{
+  if (blockSize < 1 || blockSize > s_maxBlockSize) {
+    GLIMPROC_LOGE("invalid block size %d.\n", blockSize);
+    return false;
+  }
+  m_maxValue = maxValue;
+  m_blockSize = blockSize;
+  m_k = static_cast<GLfloat>(k);
+  m_r = static_cast<GLfloat>(r);
+  if (!m_table.init(pm, true)) {
+    return false;
+  }
+  const char* defines =
+    method == BINARIZATION_SAUVOLA ? "#define SAUVOLA\n" : "";
+  m_program =
+    pm->getProgram(GLProgramManager::LOCALDEVIATIONTHRESHOLD, defines);
+  m_programPacked =
+    pm->getProgram(GLProgramManager::LOCALDEVIATIONTHRESHOLD,
+                   std::string(defines) + "#define PACKED\n");
+  if (!m_program || !m_programPacked) {
+    return false;
+  }
+  GLint program = m_program;
+  m_uTexture = glGetUniformLocation(program, "u_texture");
+  m_uTable = glGetUniformLocation(program, "u_table");
+  m_uBlockSize = glGetUniformLocation(program, "u_blockSize");
+  m_uMaxValue = glGetUniformLocation(program, "u_maxValue");
+  m_uK = glGetUniformLocation(program, "u_k");
+  m_uR = glGetUniformLocation(program, "u_r");
+
+  program = m_programPacked;
+  m_uTexturePacked = glGetUniformLocation(program, "u_texture");
+  m_uTablePacked = glGetUniformLocation(program, "u_table");
+  m_uBlockSizePacked = glGetUniformLocation(program, "u_blockSize");
+  m_uPixelWidthPacked = glGetUniformLocation(program, "u_pixelWidth");
+  m_uMaxValuePacked = glGetUniformLocation(program, "u_maxValue");
+  m_uKPacked = glGetUniformLocation(program, "u_k");
+  m_uRPacked = glGetUniformLocation(program, "u_r");
+  return checkError("SauvolaThresholdProcessor::init");
+}
+
+ProcessorFootprint
+SauvolaThresholdProcessor::footprint() const
+{
+  GLint half = m_blockSize / 2;
+  GLint rest = m_blockSize - 1 - half;
+  return ProcessorFootprint{ half, rest, rest, half };
+}
+
+ProcessorExtent
+SauvolaThresholdProcessor::scratchExtent() const
+{
+  return SummedAreaTable::extent(footprint());
+}
+
+ProcessorOutput
+SauvolaThresholdProcessor::process(const ProcessorInput& pin)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  ProcessorFootprint block = footprint();
+  std::shared_ptr<GLTexture> table = m_table.build(pin, block);
+  if (!table) {
+    // logged by build().
+    return ProcessorOutput{ nullptr };
+  }
+  FBOScope fboscope(wf);
+  std::shared_ptr<GLTexture> target = wf->requestTextureForFramebuffer();
+  GLint blockSize[2] = { m_blockSize, m_blockSize };
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  glActiveTexture(GL_TEXTURE0 + 1);
+  glBindTexture(GL_TEXTURE_2D, table->id());
+  GLfloat maxValue = static_cast<float>(m_maxValue) / 255.0f;
+  if (pin.packed) {
+    glUseProgram(m_programPacked);
+    glUniform1i(m_uTexturePacked, 0);
+    glUniform1i(m_uTablePacked, 1);
+    glUniform2iv(m_uBlockSizePacked, 1, blockSize);
+    glUniform1i(m_uPixelWidthPacked, pin.pixelWidth);
+    glUniform1f(m_uMaxValuePacked, maxValue);
+    glUniform1f(m_uKPacked, m_k);
+    glUniform1f(m_uRPacked, m_r);
+  } else {
+    glUseProgram(m_program);
+    glUniform1i(m_uTexture, 0);
+    glUniform1i(m_uTable, 1);
+    glUniform2iv(m_uBlockSize, 1, blockSize);
+    glUniform1f(m_uMaxValue, maxValue);
+    glUniform1f(m_uK, m_k);
+    glUniform1f(m_uR, m_r);
+  }
+
+  wf->bindRenderTarget(target.get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+  checkError("SauvolaThresholdProcessor::process");
+  return ProcessorOutput{ target };
+}
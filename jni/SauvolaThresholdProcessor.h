@@ -0,0 +1,57 @@
+#ifndef SAUVOLATHRESHOLDPROCESSOR_H
+#define SAUVOLATHRESHOLDPROCESSOR_H
+#include "IImageProcessor.h"
+#include "SummedAreaTable.h"
+
+class GLProgramManager;
+
+// maxValue where a pixel is above a threshold made of the mean and the
+// standard deviation of the blockSize x blockSize pixels around it, as
+// cv::ximgproc::niBlackThreshold with THRESH_BINARY but mirrored at the
+// borders. Both come from one summed-area table of the values and their
+// squares, built in the same passes (gles3).
+class SauvolaThresholdProcessor final : public IImageProcessor
+{
+public:
+  enum Method
+  {
+    // mean + k * deviation.
+    BINARIZATION_NIBLACK,
+    // mean * (1 + k * (deviation / r - 1)).
+    BINARIZATION_SAUVOLA,
+  };
+  SauvolaThresholdProcessor();
+  ~SauvolaThresholdProcessor() = default;
+  // the squares of a block must fit 32 bits, blockSize is at most 257.
+  bool init(GLProgramManager* pm, int maxValue, Method method, int blockSize,
+            double k, double r = 128.0);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  ProcessorFootprint footprint() const override;
+  ProcessorExtent scratchExtent() const override;
+  bool supportsPackedLuma() const override { return true; }
+
+private:
+  SummedAreaTable m_table;
+  GLint m_maxValue;
+  GLint m_blockSize;
+  GLfloat m_k;
+  GLfloat m_r;
+
+  GLint m_uTexture;
+  GLint m_uTable;
+  GLint m_uBlockSize;
+  GLint m_uMaxValue;
+  GLint m_uK;
+  GLint m_uR;
+  GLint m_program;
+
+  GLint m_uTexturePacked;
+  GLint m_uTablePacked;
+  GLint m_uBlockSizePacked;
+  GLint m_uPixelWidthPacked;
+  GLint m_uMaxValuePacked;
+  GLint m_uKPacked;
+  GLint m_uRPacked;
+  GLint m_programPacked;
+};
+#endif /* SAUVOLATHRESHOLDPROCESSOR_H */
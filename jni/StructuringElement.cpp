@@ -0,0 +1,189 @@
+#include "StructuringElement.h"
+#include <algorithm>
+#include <math.h>
+
+StructuringElement::StructuringElement()
+  : m_width(0)
+  , m_height(0)
+  , m_anchorX(0)
+  , m_anchorY(0)
+{
+}
+
+StructuringElement
+StructuringElement::rectangle(GLint width, GLint height)
+{
+  return rectangle(width, height, width / 2, height / 2);
+}
+
+StructuringElement
+StructuringElement::rectangle(GLint width, GLint height, GLint anchorX,
+                              GLint anchorY)
+{
+  std::vector<uint8_t> mask(width * height, 255);
+  return custom(width, height, mask, anchorX, anchorY);
+}
+
+StructuringElement
+StructuringElement::ellipse(GLint width, GLint height)
+{
+  std::vector<uint8_t> mask(width * height, 0);
+  GLint r = height / 2, c = width / 2;
+  double invR2 = r ? 1.0 / (static_cast<double>(r) * r) : 0.0;
+  for (GLint j = 0; j < height; ++j) {
+    GLint dy = j - r;
+    if (abs(dy) > r) {
+      continue;
+    }
+    GLint dx = static_cast<GLint>(lrint(c * sqrt((r * r - dy * dy) * invR2)));
+    GLint first = std::max(c - dx, 0);
+    GLint end = std::min(c + dx + 1, width);
+    std::fill(mask.begin() + j * width + first, mask.begin() + j * width + end,
+              255);
+  }
+  return custom(width, height, mask, width / 2, height / 2);
+}
+
+StructuringElement
+StructuringElement::cross(GLint width, GLint height)
+{
+  std::vector<uint8_t> mask(width * height, 0);
+  GLint anchorX = width / 2, anchorY = height / 2;
+  for (GLint j = 0; j < height; ++j) {
+    mask[j * width + anchorX] = 255;
+  }
+  std::fill(mask.begin() + anchorY * width,
+            mask.begin() + (anchorY + 1) * width, 255);
+  return custom(width, height, mask, anchorX, anchorY);
+}
+
+StructuringElement
+StructuringElement::custom(GLint width, GLint height,
+                           const std::vector<uint8_t>& mask, GLint anchorX,
+                           GLint anchorY)
+{
+  StructuringElement element;
+  element.m_width = width;
+  element.m_height = height;
+  element.m_anchorX = anchorX;
+  element.m_anchorY = anchorY;
+  element.m_mask.resize(width * height);
+  for (size_t i = 0; i < element.m_mask.size() && i < mask.size(); ++i) {
+    element.m_mask[i] = mask[i] ? 255 : 0;
+  }
+  return element;
+}
+
+StructuringElement
+StructuringElement::repeated(unsigned times) const
+{
+  if (times <= 1) {
+    return *this;
+  }
+  // the set cells of the sum are the sums of set cells of the addends.
+  StructuringElement sum = *this;
+  for (unsigned t = 1; t < times; ++t) {
+    GLint width = sum.m_width + m_width - 1;
+    GLint height = sum.m_height + m_height - 1;
+    std::vector<uint8_t> mask(width * height, 0);
+    for (GLint j = 0; j < sum.m_height; ++j) {
+      for (GLint i = 0; i < sum.m_width; ++i) {
+        if (!sum.isSet(i, j)) {
+          continue;
+        }
+        for (GLint v = 0; v < m_height; ++v) {
+          for (GLint u = 0; u < m_width; ++u) {
+            if (isSet(u, v)) {
+              mask[(j + v) * width + i + u] = 255;
+            }
+          }
+        }
+      }
+    }
+    sum = custom(width, height, mask, sum.m_anchorX + m_anchorX,
+                 sum.m_anchorY + m_anchorY);
+  }
+  return sum;
+}
+
+bool
+StructuringElement::empty() const
+{
+  return std::find(m_mask.begin(), m_mask.end(), 255) == m_mask.end();
+}
+
+std::vector<StructuringElement::Rectangle>
+StructuringElement::decompose() const
+{
+  std::vector<Rectangle> rectangles;
+  for (GLint j = 0; j < m_height; ++j) {
+    for (GLint i = 0; i < m_width;) {
+      if (!isSet(i, j)) {
+        ++i;
+        continue;
+      }
+      GLint first = i;
+      while (i < m_width && isSet(i, j)) {
+        ++i;
+      }
+      auto holdsRun = [this, first, i](GLint row) {
+        for (GLint u = first; u < i; ++u) {
+          if (!isSet(u, row)) {
+            return false;
+          }
+        }
+        return true;
+      };
+      GLint bottom = j, top = j;
+      while (bottom > 0 && holdsRun(bottom - 1)) {
+        --bottom;
+      }
+      while (top + 1 < m_height && holdsRun(top + 1)) {
+        ++top;
+      }
+      Rectangle r = { first - m_anchorX, bottom - m_anchorY, i - first,
+                      top - bottom + 1 };
+      rectangles.push_back(r);
+    }
+  }
+  auto inside = [](const Rectangle& a, const Rectangle& b) {
+    return a.x >= b.x && a.y >= b.y && a.x + a.width <= b.x + b.width &&
+           a.y + a.height <= b.y + b.height;
+  };
+  std::vector<Rectangle> kept;
+  for (size_t a = 0; a < rectangles.size(); ++a) {
+    bool redundant = false;
+    for (size_t b = 0; b < rectangles.size() && !redundant; ++b) {
+      // of equal rectangles the first one is kept.
+      redundant = b != a && inside(rectangles[a], rectangles[b]) &&
+                  (!inside(rectangles[b], rectangles[a]) || b < a);
+    }
+    if (!redundant) {
+      kept.push_back(rectangles[a]);
+    }
+  }
+  return kept;
+}
+
+ProcessorFootprint
+StructuringElement::footprint() const
+{
+  ProcessorFootprint f = { 0, 0, 0, 0 };
+  for (GLint j = 0; j < m_height; ++j) {
+    for (GLint i = 0; i < m_width; ++i) {
+      if (isSet(i, j)) {
+        f.left = std::max(f.left, m_anchorX - i);
+        f.right = std::max(f.right, i - m_anchorX);
+        f.bottom = std::max(f.bottom, m_anchorY - j);
+        f.top = std::max(f.top, j - m_anchorY);
+      }
+    }
+  }
+  return f;
+}
+
+bool
+StructuringElement::isSet(GLint i, GLint j) const
+{
+  return m_mask[j * m_width + i] != 0;
+}
@@ -0,0 +1,54 @@
+#ifndef STRUCTURINGELEMENT_H
+#define STRUCTURINGELEMENT_H
+#include "IImageProcessor.h"
+#include <stdint.h>
+#include <vector>
+
+// The pixels a morphology processor takes the maximum or minimum over, as
+// a mask of width x height cells. Cell (i, j) stands for the pixel
+// i - anchorX columns right of and j - anchorY rows after the output
+// pixel, rows counting like those of the image.
+class StructuringElement final
+{
+public:
+  // the cells dx in [x, x + width) and dy in [y, y + height) around the
+  // anchor.
+  struct Rectangle
+  {
+    GLint x, y, width, height;
+  };
+  StructuringElement();
+  // anchors default to (width / 2, height / 2).
+  static StructuringElement rectangle(GLint width, GLint height);
+  static StructuringElement rectangle(GLint width, GLint height,
+                                      GLint anchorX, GLint anchorY);
+  // the ellipse inscribed in the box, as cv::getStructuringElement has it.
+  static StructuringElement ellipse(GLint width, GLint height);
+  // the middle row and column of the box.
+  static StructuringElement cross(GLint width, GLint height);
+  // mask holds height rows of width cells, the nonzero ones are set.
+  static StructuringElement custom(GLint width, GLint height,
+                                   const std::vector<uint8_t>& mask,
+                                   GLint anchorX, GLint anchorY);
+  // the element applied times times in a row.
+  StructuringElement repeated(unsigned times) const;
+  GLint width() const { return m_width; }
+  GLint height() const { return m_height; }
+  GLint anchorX() const { return m_anchorX; }
+  GLint anchorY() const { return m_anchorY; }
+  // one byte per cell, 255 where set.
+  const std::vector<uint8_t>& mask() const { return m_mask; }
+  bool empty() const;
+  // rectangles whose union is the element: every run of set cells of a
+  // row, stretched over the rows around it holding the whole run, those
+  // inside another dropped. one per row width for convex elements.
+  std::vector<Rectangle> decompose() const;
+  ProcessorFootprint footprint() const;
+
+private:
+  bool isSet(GLint i, GLint j) const;
+  GLint m_width, m_height;
+  GLint m_anchorX, m_anchorY;
+  std::vector<uint8_t> m_mask;
+};
+#endif /* STRUCTURINGELEMENT_H */
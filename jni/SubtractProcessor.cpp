@@ -0,0 +1,76 @@
+#include "SubtractProcessor.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <stdlib.h>
+
+SubtractProcessor::SubtractProcessor()
+  : m_uTexture0(0)
+  , m_uTexture1(0)
+  , m_uScreenGeometry(0)
+  , m_program(0)
+  , m_uTexture0Packed(0)
+  , m_uTexture1Packed(0)
+  , m_uScreenGeometryPacked(0)
+  , m_programPacked(0)
+{
+}
+
+bool
+SubtractProcessor::init(GLProgramManager* pm)
+{
+  m_program = pm->getProgram(GLProgramManager::SUBTRACT);
+  m_programPacked = pm->getProgram(GLProgramManager::SUBTRACTPACKED);
+  if (!m_program || !m_programPacked) {
+    return false;
+  }
+  GLint program = m_program;
+  m_uTexture0 = glGetUniformLocation(program, "u_texture0");
+  m_uTexture1 = glGetUniformLocation(program, "u_texture1");
+  m_uScreenGeometry = glGetUniformLocation(program, "u_screenGeometry");
+
+  program = m_programPacked;
+  m_uTexture0Packed = glGetUniformLocation(program, "u_texture0");
+  m_uTexture1Packed = glGetUniformLocation(program, "u_texture1");
+  m_uScreenGeometryPacked = glGetUniformLocation(program, "u_screenGeometry");
+  return true;
+}
+
+ProcessorOutput
+SubtractProcessor::process(const ProcessorInput& pin)
+{
+  if (pin.inputs.size() != 2) {
+    GLIMPROC_LOGE("SubtractProcessor needs two inputs, got %zu.\n",
+                  pin.inputs.size());
+    exit(1);
+  }
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  std::shared_ptr<GLTexture> tmpTexture[1] = {
+    wf->requestTextureForFramebuffer()
+  };
+
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  GLint imageGeometry[2] = { pin.width, pin.height };
+  // setup uniforms
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.inputs[0]->id());
+  glActiveTexture(GL_TEXTURE0 + 1);
+  glBindTexture(GL_TEXTURE_2D, pin.inputs[1]->id());
+  if (pin.packed) {
+    glUseProgram(m_programPacked);
+    glUniform1i(m_uTexture0Packed, 0);
+    glUniform1i(m_uTexture1Packed, 1);
+    glUniform2iv(m_uScreenGeometryPacked, 1, imageGeometry);
+  } else {
+    glUseProgram(m_program);
+    glUniform1i(m_uTexture0, 0);
+    glUniform1i(m_uTexture1, 1);
+    glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glActiveTexture(GL_TEXTURE0);
+  return ProcessorOutput{ tmpTexture[0] };
+}
@@ -0,0 +1,28 @@
+#ifndef SUBTRACTPROCESSOR_H
+#define SUBTRACTPROCESSOR_H
+#include "IImageProcessor.h"
+
+class GLProgramManager;
+
+// Graph node with two inputs: the first minus the second, clamped at
+// zero. Dilate minus erode of one image is its morphological gradient.
+class SubtractProcessor final : public IImageProcessor
+{
+public:
+  SubtractProcessor();
+  ~SubtractProcessor() = default;
+  bool init(GLProgramManager* pm);
+  ProcessorOutput process(const ProcessorInput& desc) override;
+  bool supportsPackedLuma() const override { return true; }
+
+private:
+  GLint m_uTexture0;
+  GLint m_uTexture1;
+  GLint m_uScreenGeometry;
+  GLint m_program;
+  GLint m_uTexture0Packed;
+  GLint m_uTexture1Packed;
+  GLint m_uScreenGeometryPacked;
+  GLint m_programPacked;
+};
+#endif /* SUBTRACTPROCESSOR_H */
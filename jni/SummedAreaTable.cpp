@@ -0,0 +1,144 @@
+#include "SummedAreaTable.h"
+#include "GLProgramManager.h"
+#include "GLResources.h"
+#include "ImageProcessorWorkflow.h"
+#include <GLES3/gl3.h>
+#include <stdlib.h>
+
+SummedAreaTable::SummedAreaTable()
+  : m_squares(false)
+  , m_uTextureSeed(0)
+  , m_uImageSizeSeed(0)
+  , m_uPaddingSeed(0)
+  , m_programSeed(0)
+  , m_uTextureSeedPacked(0)
+  , m_uImageSizeSeedPacked(0)
+  , m_uPaddingSeedPacked(0)
+  , m_programSeedPacked(0)
+  , m_uTableRow(0)
+  , m_uStepRow(0)
+  , m_programRow(0)
+  , m_uTableColumn(0)
+  , m_uStepColumn(0)
+  , m_programColumn(0)
+{
+}
+
+bool
+SummedAreaTable::init(GLProgramManager* pm, bool squares)
+{
+  m_squares = squares;
+  if (!isGLES3Context()) {
+    GLIMPROC_LOGE("summed-area tables need a gles3 context.\n");
+    return false;
+  }
+  m_programSeed = pm->getProgram(GLProgramManager::SUMMEDAREASEED);
+  m_programSeedPacked =
+    pm->getProgram(GLProgramManager::SUMMEDAREASEEDPACKED);
+  m_programRow = pm->getProgram(GLProgramManager::SUMMEDAREAROW);
+  m_programColumn = pm->getProgram(GLProgramManager::SUMMEDAREACOLUMN);
+  if (!m_programSeed || !m_programSeedPacked || !m_programRow ||
+      !m_programColumn) {
+    return false;
+  }
+  GLint program = m_programSeed;
+  m_uTextureSeed = glGetUniformLocation(program, "u_texture");
+  m_uImageSizeSeed = glGetUniformLocation(program, "u_imageSize");
+  m_uPaddingSeed = glGetUniformLocation(program, "u_padding");
+
+  program = m_programSeedPacked;
+  m_uTextureSeedPacked = glGetUniformLocation(program, "u_texture");
+  m_uImageSizeSeedPacked = glGetUniformLocation(program, "u_imageSize");
+  m_uPaddingSeedPacked = glGetUniformLocation(program, "u_padding");
+
+  program = m_programRow;
+  m_uTableRow = glGetUniformLocation(program, "u_table");
+  m_uStepRow = glGetUniformLocation(program, "u_step");
+
+  program = m_programColumn;
+  m_uTableColumn = glGetUniformLocation(program, "u_table");
+  m_uStepColumn = glGetUniformLocation(program, "u_step");
+  return checkError("SummedAreaTable::init");
+}
+
+ProcessorExtent
+SummedAreaTable::extent(const ProcessorFootprint& padding)
+{
+  return ProcessorExtent{ padding.left + padding.right + 1,
+                          padding.bottom + padding.top + 1 };
+}
+
+std::shared_ptr<GLTexture>
+SummedAreaTable::build(const ProcessorInput& pin,
+                       const ProcessorFootprint& padding)
+{
+  ImageProcessorWorkflow* wf = pin.wf;
+  FBOScope fboscope(wf);
+  GLint imageSize[2] = { pin.packed ? pin.pixelWidth : pin.width,
+                         pin.height };
+  GLint offset[2] = { padding.left, padding.bottom };
+  GLint width = imageSize[0] + padding.left + padding.right + 1;
+  GLint height = imageSize[1] + padding.bottom + padding.top + 1;
+  GLint maxSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  if (width > maxSize || height > maxSize) {
+    GLIMPROC_LOGE("a summed-area table of %dx%d exceeds the texture size.\n",
+                  width, height);
+    return nullptr;
+  }
+  GLenum format = m_squares ? GL_RG32UI : GL_R32UI;
+  std::shared_ptr<GLTexture> table[2] = {
+    wf->requestTextureForFramebuffer(width, height, format),
+    wf->requestTextureForFramebuffer(width, height, format)
+  };
+  // an entry depends on every entry left of and below it.
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  glViewport(0, 0, width, height);
+
+  wf->bindRenderTarget(table[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, pin.color->id());
+  if (pin.packed) {
+    glUseProgram(m_programSeedPacked);
+    glUniform1i(m_uTextureSeedPacked, 0);
+    glUniform2iv(m_uImageSizeSeedPacked, 1, imageSize);
+    glUniform2iv(m_uPaddingSeedPacked, 1, offset);
+  } else {
+    glUseProgram(m_programSeed);
+    glUniform1i(m_uTextureSeed, 0);
+    glUniform2iv(m_uImageSizeSeed, 1, imageSize);
+    glUniform2iv(m_uPaddingSeed, 1, offset);
+  }
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+  size_t current = 0;
+  glUseProgram(m_programRow);
+  glUniform1i(m_uTableRow, 0);
+  for (GLint step = 1; step < width; step *= 4) {
+    glBindTexture(GL_TEXTURE_2D, table[current]->id());
+    current ^= 1;
+    wf->bindRenderTarget(table[current].get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glUniform1i(m_uStepRow, step);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+  glUseProgram(m_programColumn);
+  glUniform1i(m_uTableColumn, 0);
+  for (GLint step = 1; step < height; step *= 4) {
+    glBindTexture(GL_TEXTURE_2D, table[current]->id());
+    current ^= 1;
+    wf->bindRenderTarget(table[current].get());
+    CHECK_FRAMEBUFFER_COMPLETE(wf);
+    glUniform1i(m_uStepColumn, step);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  glViewport(0, 0, pin.width, pin.height);
+  if (scissor) {
+    glEnable(GL_SCISSOR_TEST);
+  }
+  checkError("SummedAreaTable::build");
+  return table[current];
+}
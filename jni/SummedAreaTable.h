@@ -0,0 +1,52 @@
+#ifndef SUMMEDAREATABLE_H
+#define SUMMEDAREATABLE_H
+#include "IImageProcessor.h"
+#include <memory>
+
+class GLProgramManager;
+class GLTexture;
+
+// The inclusive prefix sums of the 8 bit values of an image in a GL_R32UI
+// texture, built with log-step passes each adding four entries (gles3).
+// The image is extended by padding pixels per side, mirrored as the
+// sampler would, and the table starts with a row and a column of zeros.
+// The block of w x h pixels whose lower left corner is padding.left
+// columns left of and padding.bottom rows below pixel (x, y) sums to
+//   T(x + w, y + h) - T(x, y + h) - T(x + w, y) + T(x, y).
+// Entries wrap around 2^32, sums of blocks stay exact while they fit.
+// With squares the table is GL_RG32UI and its green channel sums the
+// squares of the values in the same passes.
+class SummedAreaTable final
+{
+public:
+  SummedAreaTable();
+  bool init(GLProgramManager* pm, bool squares = false);
+  // how far the tables built with padding reach past the image.
+  static ProcessorExtent extent(const ProcessorFootprint& padding);
+  // the table covers the whole image, whatever the scissor. nullptr, with
+  // a log, when it would not fit in GL_MAX_TEXTURE_SIZE.
+  std::shared_ptr<GLTexture> build(const ProcessorInput& pin,
+                                   const ProcessorFootprint& padding);
+
+private:
+  bool m_squares;
+
+  GLint m_uTextureSeed;
+  GLint m_uImageSizeSeed;
+  GLint m_uPaddingSeed;
+  GLint m_programSeed;
+
+  GLint m_uTextureSeedPacked;
+  GLint m_uImageSizeSeedPacked;
+  GLint m_uPaddingSeedPacked;
+  GLint m_programSeedPacked;
+
+  GLint m_uTableRow;
+  GLint m_uStepRow;
+  GLint m_programRow;
+
+  GLint m_uTableColumn;
+  GLint m_uStepColumn;
+  GLint m_programColumn;
+};
+#endif /* SUMMEDAREATABLE_H */
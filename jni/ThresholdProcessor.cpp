@@ -10,6 +10,11 @@ ThresholdProcessor::ThresholdProcessor()
   , m_uMaxValue(0)
   , m_uThreshold(0)
   , m_program(0)
+  , m_uTexturePacked(0)
+  , m_uScreenGeometryPacked(0)
+  , m_uMaxValuePacked(0)
+  , m_uThresholdPacked(0)
+  , m_programPacked(0)
   , m_maxValue(0)
   , m_threshold(0)
 {
@@ -32,30 +37,54 @@ ThresholdProcessor::process(const ProcessorInput& pin)
     wf->requestTextureForFramebuffer()
   };
 
-  // bind fbo and complete it.
-  wf->setColorAttachmentForFramebuffer(tmpTexture[0]->id());
-
-  if (GL_FRAMEBUFFER_COMPLETE != wf->checkFramebuffer()) {
-    GLIMPROC_LOGE("fbo is not completed %d, %x.\n", __LINE__,
-                  wf->checkFramebuffer());
-    exit(1);
-  }
+  // bind the framebuffer of the target.
+  wf->bindRenderTarget(tmpTexture[0].get());
+  CHECK_FRAMEBUFFER_COMPLETE(wf);
   GLint imageGeometry[2] = { pin.width, pin.height };
-  glUseProgram(m_program);
-  // setup uniforms
+  GLfloat maxValue = static_cast<GLfloat>(m_maxValue) / 255.0f;
+  GLfloat threshold = static_cast<GLfloat>(m_threshold) / 255.0f;
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, pin.color->id());
-  glUniform1i(m_uTexture, 0);
+  if (pin.packed) {
+    glUseProgram(m_programPacked);
+    glUniform1i(m_uTexturePacked, 0);
+    glUniform2iv(m_uScreenGeometryPacked, 1, imageGeometry);
+    glUniform1f(m_uMaxValuePacked, maxValue);
+    glUniform1f(m_uThresholdPacked, threshold);
+  } else {
+    glUseProgram(m_program);
+    // setup uniforms
+    glUniform1i(m_uTexture, 0);
 
-  glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
-  // setup kernel and block size
+    glUniform2iv(m_uScreenGeometry, 1, imageGeometry);
+    // setup kernel and block size
 
-  glUniform1f(m_uMaxValue, static_cast<GLfloat>(m_maxValue) / 255.0f);
-  glUniform1f(m_uThreshold, static_cast<GLfloat>(m_threshold) / 255.0f);
+    glUniform1f(m_uMaxValue, maxValue);
+    glUniform1f(m_uThreshold, threshold);
+  }
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   return ProcessorOutput{ tmpTexture[0] };
 }
 
+bool
+ThresholdProcessor::describe(ProcessorDescription* desc) const
+{
+  *desc = ProcessorDescription();
+  desc->kind = ProcessorDescription::THRESHOLD;
+  desc->maxValue = m_maxValue;
+  desc->threshold = m_threshold;
+  // thresholdSource samples three rows above the output pixel.
+  desc->offsetX = 0;
+  desc->offsetY = 3;
+  return true;
+}
+
+ProcessorFootprint
+ThresholdProcessor::footprint() const
+{
+  return ProcessorFootprint{ 0, 0, 0, 3 };
+}
+
 bool
 ThresholdProcessor::initProgram(GLProgramManager* pm)
 {
@@ -70,5 +99,14 @@ ThresholdProcessor::initProgram(GLProgramManager* pm)
   GLIMPROC_LOGI("m_uTexture: %d, m_uScreenGeometry: %d, m_uMaxValue: %d, "
                 "m_uThreshold: %d.\n",
                 m_uTexture, m_uScreenGeometry, m_uMaxValue, m_uThreshold);
+
+  m_programPacked = pm->getProgram(GLProgramManager::THRESHOLDPACKED);
+  if (!m_programPacked)
+    return false;
+  program = m_programPacked;
+  m_uTexturePacked = glGetUniformLocation(program, "u_texture");
+  m_uScreenGeometryPacked = glGetUniformLocation(program, "u_screenGeometry");
+  m_uMaxValuePacked = glGetUniformLocation(program, "u_maxValue");
+  m_uThresholdPacked = glGetUniformLocation(program, "u_threshold");
   return true;
 }
@@ -11,6 +11,9 @@ public:
   ~ThresholdProcessor() = default;
   bool init(GLProgramManager* pm, int maxValue, int threshold);
   ProcessorOutput process(const ProcessorInput& desc) override;
+  bool describe(ProcessorDescription* desc) const override;
+  ProcessorFootprint footprint() const override;
+  bool supportsPackedLuma() const override { return true; }
 
 private:
   GLint m_uTexture;
@@ -18,6 +21,11 @@ private:
   GLint m_uMaxValue;
   GLint m_uThreshold;
   GLint m_program;
+  GLint m_uTexturePacked;
+  GLint m_uScreenGeometryPacked;
+  GLint m_uMaxValuePacked;
+  GLint m_uThresholdPacked;
+  GLint m_programPacked;
   int m_maxValue;
   int m_threshold;
   bool initProgram(GLProgramManager* pm);
@@ -1,13 +1,15 @@
 ---gaussianFragRowSource
 uniform sampler2D u_texture;
 uniform ivec2 u_screenGeometry;
-uniform mediump vec4 u_kernel[92 / 4];
-const mediump float c_blockSize = 92.0;
+// BLOCK_SIZE and TAP_COUNT are defined by GaussianBlurProcessor, the
+// kernel is padded with zeros to whole vec4s.
+uniform mediump vec4 u_kernel[(BLOCK_SIZE + 3) / 4];
+const mediump float c_blockSize = float(BLOCK_SIZE);
 
 void main(void)
 {
     mediump float i;
-    highp vec2 texcoord = (gl_FragCoord.xy - vec2(c_blockSize / 2.0, 0)) /
+    highp vec2 texcoord = (gl_FragCoord.xy - vec2(float(BLOCK_SIZE / 2), 0)) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.x);
     highp vec3 color = vec3(0.0);
@@ -23,13 +25,13 @@ u_kernel[int(i / 4.0)]);
 ---gaussianFragColumnSource
 uniform sampler2D u_texture;
 uniform ivec2 u_screenGeometry;
-uniform mediump vec4 u_kernel[92 / 4];
-const mediump float c_blockSize = 92.0;
+uniform mediump vec4 u_kernel[(BLOCK_SIZE + 3) / 4];
+const mediump float c_blockSize = float(BLOCK_SIZE);
 
 void main(void)
 {
     mediump float i;
-    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0, c_blockSize / 2.0)) /
+    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0, float(BLOCK_SIZE / 2))) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.y);
     highp vec3 color = vec3(0.0);
@@ -44,6 +46,8 @@ toffset)).r), u_kernel[int(i / 4.0)]);
 }
 ---adaptiveThresholdFragSource
 uniform mediump float u_maxValue;
+// the C of opencv rounded up, the pixel must exceed the mean minus it.
+uniform mediump float u_delta;
 uniform ivec2 u_screenGeometry;
 uniform sampler2D u_textureOrig;
 uniform sampler2D u_textureBlur;
@@ -53,18 +57,23 @@ void main(void)
     highp vec2 texcoord = gl_FragCoord.xy / vec2(u_screenGeometry);
     mediump float colorOrig = texture2D(u_textureOrig, texcoord).r;
     mediump float colorBlur = texture2D(u_textureBlur, texcoord).r;
+    // compared in whole 8 bit steps.
+    mediump float diff = floor(colorOrig * 255.0 + 0.5) -
+floor(colorBlur * 255.0 + 0.5);
     mediump vec3 result;
-    result = vec3(colorOrig > colorBlur ? u_maxValue : 0.0);
+    result = vec3(diff > -u_delta ? u_maxValue : 0.0);
     gl_FragColor = vec4(result, 1.0);
 }
 ---dilateNonZeroRowSource
 uniform highp ivec2 u_screenGeometry;
 uniform int u_kRowSize;
+// pixels the window starts left of the pixel.
+uniform int u_kRowAnchor;
 uniform sampler2D u_texture;
 
 void main(void)
 {
-    highp vec2 texcoord = (gl_FragCoord.xy - vec2(float(u_kRowSize / 2), 0.0)) /
+    highp vec2 texcoord = (gl_FragCoord.xy - vec2(float(u_kRowAnchor), 0.0)) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.x);
     highp vec4 m = vec4(0.0);
@@ -78,11 +87,13 @@ vec2(u_screenGeometry);
 ---dilateNonZeroColumnSource
 uniform highp ivec2 u_screenGeometry;
 uniform int u_kColumnSize;
+// rows the window starts above the pixel, it runs downwards.
+uniform int u_kColumnAnchor;
 uniform sampler2D u_texture;
 
 void main(void)
 {
-    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0.0, float(u_kColumnSize / 2 + 0))) /
+    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0.0, float(u_kColumnAnchor))) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.y);
     highp vec4 m = vec4(0.0);
@@ -96,11 +107,13 @@ vec2(u_screenGeometry);
 ---erodeNonZeroRowSource
 uniform highp ivec2 u_screenGeometry;
 uniform int u_kRowSize;
+// pixels the window starts left of the pixel.
+uniform int u_kRowAnchor;
 uniform sampler2D u_texture;
 
 void main(void)
 {
-    highp vec2 texcoord = (gl_FragCoord.xy - vec2(float(u_kRowSize / 2), 0.0)) /
+    highp vec2 texcoord = (gl_FragCoord.xy - vec2(float(u_kRowAnchor), 0.0)) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.x);
     highp vec4 m = vec4(0.9999999);
@@ -114,11 +127,13 @@ vec2(u_screenGeometry);
 ---erodeNonZeroColumnSource
 uniform highp ivec2 u_screenGeometry;
 uniform int u_kColumnSize;
+// rows the window starts above the pixel, it runs downwards.
+uniform int u_kColumnAnchor;
 uniform sampler2D u_texture;
 
 void main(void)
 {
-    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0.0, float(u_kColumnSize / 2 + 0))) /
+    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0.0, float(u_kColumnAnchor))) /
 vec2(u_screenGeometry);
     highp float toffset = 1.0 / float(u_screenGeometry.y);
     highp vec4 m = vec4(0.9999999);
@@ -142,9 +157,1496 @@ vec2(u_screenGeometry);
     highp float rcolor = texture2D(u_texture, texcoord).r;
     gl_FragColor = vec4(rcolor > u_threshold ? u_maxValue : 0.0);
 }
+---packGraySource
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_texture;
+
+void main(void)
+{
+    highp vec2 size = vec2(u_screenGeometry);
+    highp float x = floor(gl_FragCoord.x) * 4.0;
+    highp float y = gl_FragCoord.y;
+    gl_FragColor = vec4(texture2D(u_texture, vec2(x + 0.5, y) / size).r,
+texture2D(u_texture, vec2(x + 1.5, y) / size).r,
+texture2D(u_texture, vec2(x + 2.5, y) / size).r,
+texture2D(u_texture, vec2(x + 3.5, y) / size).r);
+}
+---packBinarySource
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_texture;
+
+highp float packByte(highp float x, highp float y, highp vec2 size)
+{
+    highp float byte = 0.0;
+    highp float bit = 128.0;
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        highp float px = x + float(i);
+        if (px < size.x && texture2D(u_texture, vec2(px + 0.5, y) / size).r > 0.0) {
+            byte += bit;
+        }
+        bit *= 0.5;
+    }
+    return byte / 255.0;
+}
+
+void main(void)
+{
+    highp vec2 size = vec2(u_screenGeometry);
+    highp float x = floor(gl_FragCoord.x) * 32.0;
+    highp float y = gl_FragCoord.y;
+    gl_FragColor = vec4(packByte(x, y, size), packByte(x + 8.0, y, size),
+packByte(x + 16.0, y, size), packByte(x + 24.0, y, size));
+}
+---subtractSource
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_texture0;
+uniform sampler2D u_texture1;
+
+void main(void)
+{
+    highp vec2 texcoord = gl_FragCoord.xy / vec2(u_screenGeometry);
+    mediump float a = texture2D(u_texture0, texcoord).r;
+    mediump float b = texture2D(u_texture1, texcoord).r;
+    gl_FragColor = vec4(max(a - b, 0.0));
+}
+---gaussianFragRowPackedSource
+uniform sampler2D u_texture;
+uniform ivec2 u_screenGeometry;
+uniform highp float u_imageWidth;
+uniform mediump vec4 u_kernel[(BLOCK_SIZE + 3) / 4];
+// the taps of pixel 4t start c_shift pixels into texel t + c_firstTexel.
+const int c_firstTexel = -((BLOCK_SIZE / 2 + 3) / 4);
+const int c_shift = 4 * ((BLOCK_SIZE / 2 + 3) / 4) - BLOCK_SIZE / 2;
+
+// pixel p of row y, mirrored at the image borders like the sampler
+// mirrors an unpacked image.
+mediump float pixelAt(highp float p, highp float y)
+{
+    highp float w = u_imageWidth;
+    p = mod(p, 2.0 * w);
+    p = p < w ? p : 2.0 * w - 1.0 - p;
+    highp float t = floor(p / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, y) /
+vec2(u_screenGeometry));
+    highp float c = p - 4.0 * t;
+    return c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w);
+}
+
+// pixels 4t to 4t + 3 of row y, only texels at the borders are assembled
+// pixel by pixel.
+mediump vec4 texelAt(highp float t, highp float y)
+{
+    if (t >= 0.0 && 4.0 * t + 4.0 <= u_imageWidth) {
+        return texture2D(u_texture, vec2(t + 0.5, y) / vec2(u_screenGeometry));
+    }
+    return vec4(pixelAt(4.0 * t, y), pixelAt(4.0 * t + 1.0, y),
+pixelAt(4.0 * t + 2.0, y), pixelAt(4.0 * t + 3.0, y));
+}
+
+// four consecutive pixels starting s pixels into a, followed by b and c.
+mediump vec4 window(mediump vec4 a, mediump vec4 b, mediump vec4 c, int s)
+{
+    if (s == 0) return a;
+    if (s == 1) return vec4(a.yzw, b.x);
+    if (s == 2) return vec4(a.zw, b.xy);
+    if (s == 3) return vec4(a.w, b.xyz);
+    if (s == 4) return b;
+    if (s == 5) return vec4(b.yzw, c.x);
+    if (s == 6) return vec4(b.zw, c.xy);
+    return vec4(b.w, c.xyz);
+}
+
+void main(void)
+{
+    highp float t = floor(gl_FragCoord.x) + float(c_firstTexel);
+    highp float y = gl_FragCoord.y;
+    mediump vec4 a = texelAt(t, y);
+    mediump vec4 b = texelAt(t + 1.0, y);
+    highp vec4 color = vec4(0.0);
+    int i;
+    for (i = 0; i < (BLOCK_SIZE + 3) / 4; ++i) {
+        // every texel is fetched once and shared by the four lanes.
+        mediump vec4 c = texelAt(t + float(i + 2), y);
+        color.x += dot(window(a, b, c, c_shift), u_kernel[i]);
+        color.y += dot(window(a, b, c, c_shift + 1), u_kernel[i]);
+        color.z += dot(window(a, b, c, c_shift + 2), u_kernel[i]);
+        color.w += dot(window(a, b, c, c_shift + 3), u_kernel[i]);
+        a = b;
+        b = c;
+    }
+    gl_FragColor = color;
+}
+---gaussianFragColumnPackedSource
+uniform sampler2D u_texture;
+uniform ivec2 u_screenGeometry;
+uniform mediump vec4 u_kernel[(BLOCK_SIZE + 3) / 4];
+const mediump float c_blockSize = float(BLOCK_SIZE);
+
+// the four lanes of a texel are blurred at once.
+void main(void)
+{
+    mediump float i;
+    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0, float(BLOCK_SIZE / 2))) /
+vec2(u_screenGeometry);
+    highp float toffset = 1.0 / float(u_screenGeometry.y);
+    highp vec4 color = vec4(0.0);
+    for (i = 0.0; i < c_blockSize; i += 4.0) {
+       mediump vec4 k = u_kernel[int(i / 4.0)];
+       mediump vec4 t0 = texture2D(u_texture, texcoord - vec2(0.0, i * toffset));
+       mediump vec4 t1 = texture2D(u_texture, texcoord - vec2(0.0, (1.0 + i) *
+toffset));
+       mediump vec4 t2 = texture2D(u_texture, texcoord - vec2(0.0, (2.0 + i) *
+toffset));
+       mediump vec4 t3 = texture2D(u_texture, texcoord - vec2(0.0, (3.0 + i) *
+toffset));
+       color += vec4(dot(vec4(t0.x, t1.x, t2.x, t3.x), k),
+dot(vec4(t0.y, t1.y, t2.y, t3.y), k), dot(vec4(t0.z, t1.z, t2.z, t3.z), k),
+dot(vec4(t0.w, t1.w, t2.w, t3.w), k));
+    }
+    gl_FragColor = color;
+}
+---adaptiveThresholdPackedSource
+uniform mediump float u_maxValue;
+uniform mediump float u_delta;
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_textureOrig;
+uniform sampler2D u_textureBlur;
+
+void main(void)
+{
+    highp vec2 texcoord = gl_FragCoord.xy / vec2(u_screenGeometry);
+    mediump vec4 colorOrig = texture2D(u_textureOrig, texcoord);
+    mediump vec4 colorBlur = texture2D(u_textureBlur, texcoord);
+    mediump vec4 diff = floor(colorOrig * 255.0 + 0.5) -
+floor(colorBlur * 255.0 + 0.5);
+    gl_FragColor = vec4(greaterThan(diff, vec4(-u_delta))) * u_maxValue;
+}
+---dilateNonZeroRowPackedSource
+uniform highp ivec2 u_screenGeometry;
+uniform highp float u_imageWidth;
+uniform int u_kRowSize;
+// pixels the window starts left of the pixel.
+uniform int u_kRowAnchor;
+uniform sampler2D u_texture;
+
+// pixel p of row y, mirrored at the image borders like the sampler
+// mirrors an unpacked image.
+mediump float pixelAt(highp float p, highp float y)
+{
+    highp float w = u_imageWidth;
+    p = mod(p, 2.0 * w);
+    p = p < w ? p : 2.0 * w - 1.0 - p;
+    highp float t = floor(p / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, y) /
+vec2(u_screenGeometry));
+    highp float c = p - 4.0 * t;
+    return c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w);
+}
+
+// pixels 4t to 4t + 3 of row y, only texels at the borders are assembled
+// pixel by pixel.
+mediump vec4 texelAt(highp float t, highp float y)
+{
+    if (t >= 0.0 && 4.0 * t + 4.0 <= u_imageWidth) {
+        return texture2D(u_texture, vec2(t + 0.5, y) / vec2(u_screenGeometry));
+    }
+    return vec4(pixelAt(4.0 * t, y), pixelAt(4.0 * t + 1.0, y),
+pixelAt(4.0 * t + 2.0, y), pixelAt(4.0 * t + 3.0, y));
+}
+
+// each texel holds four pixels, pixel 4t + i of a lane reads pixels
+// 4t + i - a to 4t + i - a + k - 1, a being the anchor.
+void main(void)
+{
+    highp float t = floor(gl_FragCoord.x);
+    highp float y = gl_FragCoord.y;
+    highp vec4 start = vec4(4.0 * t - float(u_kRowAnchor)) +
+vec4(0.0, 1.0, 2.0, 3.0);
+    highp float end = float(u_kRowSize) - 1.0;
+    highp float first = floor(start.x / 4.0);
+    int count = int(floor((start.w + end) / 4.0) - first) + 1;
+    highp vec4 m = vec4(0.0);
+    int j;
+
+    for (j = 0; j < count; ++j) {
+        highp float s = first + float(j);
+        mediump vec4 v = texelAt(s, y);
+        // offsets of the pixels of v in the window of each lane.
+        highp vec4 d = vec4(4.0 * s) - start;
+        m = max(m, v.x * step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = max(m, v.y * step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = max(m, v.z * step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = max(m, v.w * step(0.0, d) * step(d, vec4(end)));
+    }
+    gl_FragColor = m;
+}
+---erodeNonZeroRowPackedSource
+uniform highp ivec2 u_screenGeometry;
+uniform highp float u_imageWidth;
+uniform int u_kRowSize;
+// pixels the window starts left of the pixel.
+uniform int u_kRowAnchor;
+uniform sampler2D u_texture;
+
+// pixel p of row y, mirrored at the image borders like the sampler
+// mirrors an unpacked image.
+mediump float pixelAt(highp float p, highp float y)
+{
+    highp float w = u_imageWidth;
+    p = mod(p, 2.0 * w);
+    p = p < w ? p : 2.0 * w - 1.0 - p;
+    highp float t = floor(p / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, y) /
+vec2(u_screenGeometry));
+    highp float c = p - 4.0 * t;
+    return c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w);
+}
+
+// pixels 4t to 4t + 3 of row y, only texels at the borders are assembled
+// pixel by pixel.
+mediump vec4 texelAt(highp float t, highp float y)
+{
+    if (t >= 0.0 && 4.0 * t + 4.0 <= u_imageWidth) {
+        return texture2D(u_texture, vec2(t + 0.5, y) / vec2(u_screenGeometry));
+    }
+    return vec4(pixelAt(4.0 * t, y), pixelAt(4.0 * t + 1.0, y),
+pixelAt(4.0 * t + 2.0, y), pixelAt(4.0 * t + 3.0, y));
+}
+
+// each texel holds four pixels, pixel 4t + i of a lane reads pixels
+// 4t + i - a to 4t + i - a + k - 1, a being the anchor.
+void main(void)
+{
+    highp float t = floor(gl_FragCoord.x);
+    highp float y = gl_FragCoord.y;
+    highp vec4 start = vec4(4.0 * t - float(u_kRowAnchor)) +
+vec4(0.0, 1.0, 2.0, 3.0);
+    highp float end = float(u_kRowSize) - 1.0;
+    highp float first = floor(start.x / 4.0);
+    int count = int(floor((start.w + end) / 4.0) - first) + 1;
+    highp vec4 m = vec4(0.9999999);
+    int j;
+
+    for (j = 0; j < count; ++j) {
+        highp float s = first + float(j);
+        mediump vec4 v = texelAt(s, y);
+        // offsets of the pixels of v in the window of each lane.
+        highp vec4 d = vec4(4.0 * s) - start;
+        m = min(m, v.x + 1.0 - step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = min(m, v.y + 1.0 - step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = min(m, v.z + 1.0 - step(0.0, d) * step(d, vec4(end)));
+        d += 1.0;
+        m = min(m, v.w + 1.0 - step(0.0, d) * step(d, vec4(end)));
+    }
+    gl_FragColor = m;
+}
+---thresholdPackedSource
+uniform ivec2 u_screenGeometry;
+uniform mediump float u_maxValue;
+uniform mediump float u_threshold;
+uniform sampler2D u_texture;
+
+void main(void)
+{
+    highp vec2 texcoord = (gl_FragCoord.xy + vec2(0.0, 3.0)) /
+vec2(u_screenGeometry);
+    highp vec4 color = texture2D(u_texture, texcoord);
+    gl_FragColor = vec4(greaterThan(color, vec4(u_threshold))) * u_maxValue;
+}
+---subtractPackedSource
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_texture0;
+uniform sampler2D u_texture1;
+
+void main(void)
+{
+    highp vec2 texcoord = gl_FragCoord.xy / vec2(u_screenGeometry);
+    mediump vec4 a = texture2D(u_texture0, texcoord);
+    mediump vec4 b = texture2D(u_texture1, texcoord);
+    gl_FragColor = max(a - b, 0.0);
+}
+---unpackGraySource
+uniform ivec2 u_screenGeometry;
+uniform sampler2D u_texture;
+
+void main(void)
+{
+    highp float x = floor(gl_FragCoord.x);
+    highp float t = floor(x / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, gl_FragCoord.y) /
+vec2(u_screenGeometry));
+    highp float c = x - 4.0 * t;
+    gl_FragColor = vec4(c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w));
+}
+---gaussianFragRowLinearSource
+uniform sampler2D u_texture;
+uniform ivec2 u_screenGeometry;
+// distance from the kernel center and weight of each pair of taps, the
+// pairs right of the center mirror those left of it.
+uniform highp vec2 u_taps[TAP_COUNT];
+
+void main(void)
+{
+    highp vec2 size = vec2(u_screenGeometry);
+    // between this pixel and its left neighbour for an even BLOCK_SIZE.
+    highp float center = gl_FragCoord.x - 0.5 - float(BLOCK_SIZE / 2) +
+float(BLOCK_SIZE) / 2.0;
+    highp float y = gl_FragCoord.y / size.y;
+    highp float color = 0.0;
+    for (int i = 0; i < TAP_COUNT; ++i) {
+       highp vec2 tap = u_taps[i];
+       color += tap.y * (texture2D(u_texture, vec2((center - tap.x) /
+size.x, y)).r + texture2D(u_texture, vec2((center + tap.x) / size.x, y)).r);
+    }
+    gl_FragColor = vec4(color, 0.0, 0.0, 1.0);
+}
+---gaussianFragColumnLinearSource
+uniform sampler2D u_texture;
+uniform ivec2 u_screenGeometry;
+uniform highp vec2 u_taps[TAP_COUNT];
+
+void main(void)
+{
+    highp vec2 size = vec2(u_screenGeometry);
+    // between this pixel and the one above for an even BLOCK_SIZE.
+    highp float center = gl_FragCoord.y + 0.5 + float(BLOCK_SIZE / 2) -
+float(BLOCK_SIZE) / 2.0;
+    highp float x = gl_FragCoord.x / size.x;
+    highp float color = 0.0;
+    for (int i = 0; i < TAP_COUNT; ++i) {
+       highp vec2 tap = u_taps[i];
+       color += tap.y * (texture2D(u_texture, vec2(x, (center - tap.x) /
+size.y)).r + texture2D(u_texture, vec2(x, (center + tap.x) / size.y)).r);
+    }
+    gl_FragColor = vec4(color, 0.0, 0.0, 1.0);
+}
+---gaussianFragColumnPackedLinearSource
+uniform sampler2D u_texture;
+uniform ivec2 u_screenGeometry;
+uniform highp vec2 u_taps[TAP_COUNT];
+
+// the four lanes of a texel are blurred at once.
+void main(void)
+{
+    highp vec2 size = vec2(u_screenGeometry);
+    highp float center = gl_FragCoord.y + 0.5 + float(BLOCK_SIZE / 2) -
+float(BLOCK_SIZE) / 2.0;
+    highp float x = gl_FragCoord.x / size.x;
+    highp vec4 color = vec4(0.0);
+    for (int i = 0; i < TAP_COUNT; ++i) {
+       highp vec2 tap = u_taps[i];
+       color += tap.y * (texture2D(u_texture, vec2(x, (center - tap.x) /
+size.y)) + texture2D(u_texture, vec2(x, (center + tap.x) / size.y)));
+    }
+    gl_FragColor = color;
+}
+---summedAreaSeedSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform sampler2D u_texture;
+uniform ivec2 u_imageSize;
+// columns left of and rows below the image covered by the table.
+uniform ivec2 u_padding;
+out highp uvec4 fragColor;
+
+// the pixel GL_MIRRORED_REPEAT picks for p.
+int mirror(int p, int n)
+{
+    p = p < 0 ? -1 - p : p;
+    p = p % (2 * n);
+    return p < n ? p : 2 * n - 1 - p;
+}
+
+// the table starts with a row and a column of zeros.
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    if (p.x == 0 || p.y == 0) {
+        fragColor = uvec4(0u);
+        return;
+    }
+    ivec2 src = ivec2(mirror(p.x - 1 - u_padding.x, u_imageSize.x),
+mirror(p.y - 1 - u_padding.y, u_imageSize.y));
+    uint value = uint(texelFetch(u_texture, src, 0).r * 255.0 + 0.5);
+    // the square is dropped by GL_R32UI tables.
+    fragColor = uvec4(value, value * value, 0u, 0u);
+}
+---summedAreaSeedPackedSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform sampler2D u_texture;
+// pixels, not texels.
+uniform ivec2 u_imageSize;
+uniform ivec2 u_padding;
+out highp uvec4 fragColor;
+
+int mirror(int p, int n)
+{
+    p = p < 0 ? -1 - p : p;
+    p = p % (2 * n);
+    return p < n ? p : 2 * n - 1 - p;
+}
+
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    if (p.x == 0 || p.y == 0) {
+        fragColor = uvec4(0u);
+        return;
+    }
+    int x = mirror(p.x - 1 - u_padding.x, u_imageSize.x);
+    int y = mirror(p.y - 1 - u_padding.y, u_imageSize.y);
+    uint value = uint(texelFetch(u_texture, ivec2(x / 4, y), 0)[x % 4] * 255.0 +
+0.5);
+    fragColor = uvec4(value, value * value, 0u, 0u);
+}
+---summedAreaRowSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_table;
+uniform int u_step;
+out highp uvec4 fragColor;
+
+// an entry holding the sum of u_step entries ends up with 4 * u_step.
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    uvec2 sum = texelFetch(u_table, p, 0).rg;
+    for (int i = 1; i < 4; ++i) {
+        int x = p.x - i * u_step;
+        if (x >= 0) {
+            sum += texelFetch(u_table, ivec2(x, p.y), 0).rg;
+        }
+    }
+    fragColor = uvec4(sum, 0u, 0u);
+}
+---summedAreaColumnSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_table;
+uniform int u_step;
+out highp uvec4 fragColor;
+
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    uvec2 sum = texelFetch(u_table, p, 0).rg;
+    for (int i = 1; i < 4; ++i) {
+        int y = p.y - i * u_step;
+        if (y >= 0) {
+            sum += texelFetch(u_table, ivec2(p.x, y), 0).rg;
+        }
+    }
+    fragColor = uvec4(sum, 0u, 0u);
+}
+---adaptiveMeanSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform mediump float u_maxValue;
+uniform sampler2D u_texture;
+uniform highp usampler2D u_table;
+uniform ivec2 u_blockSize;
+// the C of opencv rounded up.
+uniform int u_delta;
+out mediump vec4 fragColor;
+
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    // the sums wrap around, their difference does not.
+    uint sum = texelFetch(u_table, p + u_blockSize, 0).r -
+texelFetch(u_table, ivec2(p.x, p.y + u_blockSize.y), 0).r -
+texelFetch(u_table, ivec2(p.x + u_blockSize.x, p.y), 0).r +
+texelFetch(u_table, p, 0).r;
+    uint area = uint(u_blockSize.x * u_blockSize.y);
+    // rounded like the 8 bit blur of the gaussian method.
+    uint mean = (sum + area / 2u) / area;
+    int orig = int(texelFetch(u_texture, p, 0).r * 255.0 + 0.5);
+    bool above = orig - int(mean) > -u_delta;
+    fragColor = vec4(vec3(above ? u_maxValue : 0.0), 1.0);
+}
+---adaptiveMeanPackedSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform mediump float u_maxValue;
+uniform sampler2D u_texture;
+uniform highp usampler2D u_table;
+uniform ivec2 u_blockSize;
+uniform int u_pixelWidth;
+uniform int u_delta;
+out mediump vec4 fragColor;
+
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    vec4 orig = texelFetch(u_texture, t, 0);
+    uint area = uint(u_blockSize.x * u_blockSize.y);
+    for (int i = 0; i < 4; ++i) {
+        // the lanes past the last pixel repeat it.
+        ivec2 p = ivec2(min(4 * t.x + i, u_pixelWidth - 1), t.y);
+        uint sum = texelFetch(u_table, p + u_blockSize, 0).r -
+texelFetch(u_table, ivec2(p.x, p.y + u_blockSize.y), 0).r -
+texelFetch(u_table, ivec2(p.x + u_blockSize.x, p.y), 0).r +
+texelFetch(u_table, p, 0).r;
+        uint mean = (sum + area / 2u) / area;
+        int value = int(orig[i] * 255.0 + 0.5);
+        fragColor[i] = value - int(mean) > -u_delta ? u_maxValue : 0.0;
+    }
+}
+---adaptiveReduceSource
+uniform sampler2D u_texture;
+uniform highp vec2 u_textureSize;
+// the pixel the first reduced pixel starts at, on both axes.
+uniform highp float u_origin;
+#ifdef PACKED
+uniform highp float u_imageWidth;
+
+// pixel p of row y, mirrored at the image borders like the sampler
+// mirrors an unpacked image.
+mediump float pixelAt(highp float p, highp float y)
+{
+    highp float w = u_imageWidth;
+    p = mod(p, 2.0 * w);
+    p = p < w ? p : 2.0 * w - 1.0 - p;
+    highp float t = floor(p / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, y + 0.5) /
+u_textureSize);
+    highp float c = p - 4.0 * t;
+    return c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w);
+}
+
+// pixels 4t to 4t + 3 of row y.
+mediump vec4 texelAt(highp float t, highp float y)
+{
+    if (t >= 0.0 && 4.0 * t + 4.0 <= u_imageWidth) {
+        return texture2D(u_texture, vec2(t + 0.5, y + 0.5) / u_textureSize);
+    }
+    return vec4(pixelAt(4.0 * t, y), pixelAt(4.0 * t + 1.0, y),
+pixelAt(4.0 * t + 2.0, y), pixelAt(4.0 * t + 3.0, y));
+}
+#endif
+
+// the mean of a REDUCTION x REDUCTION block of pixels.
+void main(void)
+{
+    highp vec2 base = floor(gl_FragCoord.xy) * float(REDUCTION) + u_origin;
+    highp float sum = 0.0;
+    int i, j;
+#ifdef PACKED
+    for (j = 0; j < REDUCTION; ++j) {
+        highp float y = base.y + float(j);
+#if REDUCTION >= 4
+        // u_origin is a multiple of four, blocks start on whole texels.
+        for (i = 0; i < REDUCTION / 4; ++i) {
+            sum += dot(texelAt(base.x / 4.0 + float(i), y), vec4(1.0));
+        }
+#else
+        for (i = 0; i < REDUCTION; ++i) {
+            sum += pixelAt(base.x + float(i), y);
+        }
+#endif
+    }
+    gl_FragColor = vec4(sum / float(REDUCTION * REDUCTION));
+#else
+    // linear filtering averages the 2 x 2 pixels around each point.
+    for (j = 0; j < REDUCTION / 2; ++j) {
+        for (i = 0; i < REDUCTION / 2; ++i) {
+            highp vec2 p = base + vec2(float(2 * i + 1), float(2 * j + 1));
+            sum += texture2D(u_texture, p / u_textureSize).r;
+        }
+    }
+    gl_FragColor = vec4(sum / float(REDUCTION * REDUCTION / 4));
+#endif
+}
+---adaptivePyramidSource
+uniform mediump float u_maxValue;
+uniform mediump float u_delta;
+uniform highp vec2 u_textureSize;
+uniform sampler2D u_textureOrig;
+// the blur of the reduced image, filtered linearly.
+uniform sampler2D u_textureBlur;
+uniform highp vec2 u_blurSize;
+// the blur around pixel coordinate p is at p * u_blurScale + u_blurOffset
+// of the reduced image.
+uniform highp float u_blurScale;
+uniform highp vec2 u_blurOffset;
+
+mediump float blurAt(highp vec2 p)
+{
+    return texture2D(u_textureBlur, (p * u_blurScale + u_blurOffset) /
+u_blurSize).r;
+}
+
+void main(void)
+{
+    highp vec2 texcoord = gl_FragCoord.xy / u_textureSize;
+#ifdef PACKED
+    mediump vec4 colorOrig = texture2D(u_textureOrig, texcoord);
+    highp float x = 4.0 * floor(gl_FragCoord.x) + 0.5;
+    highp float y = gl_FragCoord.y;
+    mediump vec4 colorBlur = vec4(blurAt(vec2(x, y)),
+blurAt(vec2(x + 1.0, y)), blurAt(vec2(x + 2.0, y)), blurAt(vec2(x + 3.0, y)));
+    mediump vec4 diff = floor(colorOrig * 255.0 + 0.5) -
+floor(colorBlur * 255.0 + 0.5);
+    gl_FragColor = vec4(greaterThan(diff, vec4(-u_delta))) * u_maxValue;
+#else
+    mediump float colorOrig = texture2D(u_textureOrig, texcoord).r;
+    mediump float colorBlur = blurAt(gl_FragCoord.xy);
+    mediump float diff = floor(colorOrig * 255.0 + 0.5) -
+floor(colorBlur * 255.0 + 0.5);
+    gl_FragColor = vec4(vec3(diff > -u_delta ? u_maxValue : 0.0), 1.0);
+#endif
+}
+---localDeviationThresholdSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform mediump float u_maxValue;
+uniform sampler2D u_texture;
+// sums in red, sums of squares in green.
+uniform highp usampler2D u_table;
+uniform ivec2 u_blockSize;
+uniform int u_pixelWidth;
+uniform float u_k;
+uniform float u_r;
+out mediump vec4 fragColor;
+
+// the threshold of the block whose lower left table entry is p.
+float thresholdAt(ivec2 p)
+{
+    uvec2 sum = texelFetch(u_table, p + u_blockSize, 0).rg -
+texelFetch(u_table, ivec2(p.x, p.y + u_blockSize.y), 0).rg -
+texelFetch(u_table, ivec2(p.x + u_blockSize.x, p.y), 0).rg +
+texelFetch(u_table, p, 0).rg;
+    uint area = uint(u_blockSize.x * u_blockSize.y);
+    // the sums split into whole means and remainders, the variance
+    // n * squares - sums^2 over n^2 does not fit 32 bits.
+    uint mean = sum.x / area;
+    uint meanRest = sum.x - mean * area;
+    uint squares = sum.y / area;
+    uint squaresRest = sum.y - squares * area;
+    float n = float(area);
+    float rest = float(meanRest) / n;
+    float variance = float(int(squares) - int(mean * mean)) +
+(float(squaresRest) - 2.0 * float(mean) * float(meanRest)) / n - rest * rest;
+    float deviation = sqrt(max(variance, 0.0));
+    float m = float(mean) + rest;
+#ifdef SAUVOLA
+    return m * (1.0 + u_k * (deviation / u_r - 1.0));
+#else
+    return m + u_k * deviation;
+#endif
+}
+
+void main(void)
+{
+#ifdef PACKED
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    vec4 orig = texelFetch(u_texture, t, 0);
+    for (int i = 0; i < 4; ++i) {
+        // the lanes past the last pixel repeat it.
+        ivec2 p = ivec2(min(4 * t.x + i, u_pixelWidth - 1), t.y);
+        float value = floor(orig[i] * 255.0 + 0.5);
+        fragColor[i] = value > thresholdAt(p) ? u_maxValue : 0.0;
+    }
+#else
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    float value = floor(texelFetch(u_texture, p, 0).r * 255.0 + 0.5);
+    fragColor = vec4(vec3(value > thresholdAt(p) ? u_maxValue : 0.0), 1.0);
+#endif
+}
+---morphologyScanVertexSource
+// one quad per block, covering position u_position of the block across
+// all the lines. the scans hold a line per column, whatever the axis. a
+// corner is the block and 0 or 1 along and across the line.
+attribute highp vec3 v_corner;
+// the lines by the positions of a line.
+uniform highp vec2 u_scanSize;
+uniform highp float u_blockSize;
+uniform highp float u_position;
+varying highp vec2 v_position;
+void main()
+{
+    v_position = vec2(v_corner.z * u_scanSize.x,
+        v_corner.x * u_blockSize + u_position + v_corner.y);
+    gl_Position = vec4(v_position / u_scanSize * 2.0 - 1.0, 0.0, 1.0);
+}
+---morphologyScanSource
+// one step of the van Herk/Gil-Werman scans: a position takes the COMBINE
+// of its pixel and of the scan at the position before it in its block,
+// u_step back along the line, which the previous draw wrote to u_previous.
+// a positive step scans towards the end of the block, a negative one
+// towards its start, 0 starts a block. COMBINE is max or min.
+uniform sampler2D u_texture;
+uniform highp vec2 u_textureSize;
+uniform sampler2D u_previous;
+uniform highp vec2 u_scanSize;
+// (1, 0) along rows, (0, 1) along columns.
+uniform highp vec2 u_axis;
+// where position 0 of the line lies in u_texture.
+uniform highp float u_offset;
+uniform highp float u_length;
+uniform highp float u_step;
+#ifdef PACKED
+uniform highp float u_imageWidth;
+#endif
+varying highp vec2 v_position;
+
+mediump vec4 fetch(highp vec2 p)
+{
+#ifdef PACKED
+    // pixel p.x mirrored at the image borders like the sampler mirrors an
+    // unpacked image.
+    highp float w = u_imageWidth;
+    highp float x = mod(p.x, 2.0 * w);
+    x = x < w ? x : 2.0 * w - 1.0 - x;
+    highp float t = floor(x / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, p.y + 0.5) /
+u_textureSize);
+    highp float c = x - 4.0 * t;
+    return vec4(c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w));
+#else
+    return texture2D(u_texture, (p + 0.5) / u_textureSize);
+#endif
+}
+
+void main(void)
+{
+    // line p.x, position p.y.
+    highp vec2 p = floor(v_position);
+    mediump vec4 m =
+        fetch((p.y + u_offset) * u_axis + p.x * (vec2(1.0) - u_axis));
+    // the last block stops at the end of the line.
+    if (u_step != 0.0 && p.y - u_step < u_length) {
+        m = COMBINE(m, texture2D(u_previous, (p - vec2(0.0, u_step) + 0.5) /
+u_scanSize));
+    }
+    gl_FragColor = m;
+}
+---morphologyCombineSource
+// the window of u_kernelSize positions starting at position p of the line
+// is the COMBINE of the backward scan at p and the forward scan at its
+// last position. the scans of the even and odd positions of a block are
+// in textures of their own, a line per column.
+uniform sampler2D u_forward0;
+uniform sampler2D u_forward1;
+uniform sampler2D u_backward0;
+uniform sampler2D u_backward1;
+uniform highp vec2 u_textureSize;
+uniform highp vec2 u_axis;
+uniform highp float u_kernelSize;
+
+mediump vec4 scan(sampler2D even, sampler2D odd, highp float line,
+    highp float along)
+{
+    highp vec2 uv = (vec2(line, along) + 0.5) / u_textureSize;
+    highp float k =
+        along - u_kernelSize * floor((along + 0.5) / u_kernelSize);
+    return mix(texture2D(even, uv), texture2D(odd, uv),
+step(0.5, k - 2.0 * floor((k + 0.5) / 2.0)));
+}
+
+mediump vec4 window(highp vec2 p)
+{
+    highp float line = dot(p, vec2(1.0) - u_axis);
+    highp float along = dot(p, u_axis);
+    return COMBINE(scan(u_backward0, u_backward1, line, along),
+scan(u_forward0, u_forward1, line, along + u_kernelSize - 1.0));
+}
+
+void main(void)
+{
+    highp vec2 p = floor(gl_FragCoord.xy);
+#ifdef PACKED
+    // the scans hold one pixel per texel, four of them go to each texel.
+    gl_FragColor = vec4(window(vec2(4.0 * p.x, p.y)).r,
+window(vec2(4.0 * p.x + 1.0, p.y)).r, window(vec2(4.0 * p.x + 2.0, p.y)).r,
+window(vec2(4.0 * p.x + 3.0, p.y)).r);
+#else
+    gl_FragColor = window(p);
+#endif
+}
+---morphologyDoublingSource
+// one pass of log-doubling morphology: the window of 2s positions starting
+// at a position is the COMBINE of the windows of s positions starting at it
+// and u_stride = s positions further. the last pass overlaps the two
+// halves for sizes that are no power of two. COMBINE is max or min.
+uniform sampler2D u_texture;
+uniform highp vec2 u_textureSize;
+// (1, 0) along rows, (0, 1) along columns.
+uniform highp vec2 u_axis;
+// where the window of position 0 starts in u_texture.
+uniform highp float u_offset;
+uniform highp float u_stride;
+#ifdef UNPACK
+// the first pass along rows of packed luma.
+uniform highp float u_imageWidth;
+#endif
+
+mediump vec4 fetch(highp vec2 p)
+{
+#ifdef UNPACK
+    // pixel p.x mirrored at the image borders like the sampler mirrors an
+    // unpacked image.
+    highp float w = u_imageWidth;
+    highp float x = mod(p.x, 2.0 * w);
+    x = x < w ? x : 2.0 * w - 1.0 - x;
+    highp float t = floor(x / 4.0);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, p.y + 0.5) /
+u_textureSize);
+    highp float c = x - 4.0 * t;
+    return vec4(c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w));
+#else
+    return texture2D(u_texture, (p + 0.5) / u_textureSize);
+#endif
+}
+
+mediump vec4 window(highp vec2 p)
+{
+    p += u_offset * u_axis;
+    return COMBINE(fetch(p), fetch(p + u_stride * u_axis));
+}
+
+void main(void)
+{
+    highp vec2 p = floor(gl_FragCoord.xy);
+#ifdef PACK
+    // the last pass along rows of packed luma, four pixels per texel.
+    gl_FragColor = vec4(window(vec2(4.0 * p.x, p.y)).r,
+window(vec2(4.0 * p.x + 1.0, p.y)).r, window(vec2(4.0 * p.x + 2.0, p.y)).r,
+window(vec2(4.0 * p.x + 3.0, p.y)).r);
+#else
+    gl_FragColor = window(p);
+#endif
+}
+---morphologyMaskSource
+// the COMBINE of the pixels under the set cells of a mask, cell (i, j)
+// standing for the pixel i - u_anchor.x columns right of and
+// j - u_anchor.y rows after the output pixel. COMBINE is max or min and
+// IDENTITY the value it leaves unchanged.
+uniform sampler2D u_texture;
+uniform sampler2D u_mask;
+uniform highp vec2 u_textureSize;
+uniform highp ivec2 u_maskSize;
+uniform highp vec2 u_anchor;
+
+void main(void)
+{
+    highp vec2 p = floor(gl_FragCoord.xy) - u_anchor + 0.5;
+    highp vec2 maskSize = vec2(u_maskSize);
+    mediump vec4 m = vec4(IDENTITY);
+    int i, j;
+
+    for (j = 0; j < u_maskSize.y; ++j) {
+        for (i = 0; i < u_maskSize.x; ++i) {
+            highp vec2 cell = vec2(float(i), float(j));
+            if (texture2D(u_mask, (cell + 0.5) / maskSize).r > 0.5) {
+                m = COMBINE(m, texture2D(u_texture, (p + cell) / u_textureSize));
+            }
+        }
+    }
+    gl_FragColor = m;
+}
+---morphologyMergeSource
+// the COMBINE of two images texel by texel, packed or not.
+uniform sampler2D u_first;
+uniform sampler2D u_second;
+uniform highp vec2 u_textureSize;
+
+void main(void)
+{
+    highp vec2 texcoord = gl_FragCoord.xy / u_textureSize;
+    gl_FragColor = COMBINE(texture2D(u_first, texcoord),
+texture2D(u_second, texcoord));
+}
+---histogramScatterVertexSource
+// one point per pixel of a band of rows, landing on the bin of its value
+// in the cell of the histogram kept for its run of at most 255 pixels of a
+// row, so that the 8 bits of a bin never overflow.
+attribute highp vec2 v_position;
+uniform sampler2D u_texture;
+uniform highp vec2 u_textureSize;
+// 4 on packed luma, else 1.
+uniform highp float u_pixelsPerTexel;
+uniform highp float u_bandStart;
+// the first row of the chunk of rows the histogram counts.
+uniform highp float u_chunkStart;
+uniform highp float u_runsPerRow;
+uniform highp float u_cellsPerRow;
+uniform highp vec2 u_histogramSize;
+void main()
+{
+    highp float x = v_position.x;
+    highp float y = v_position.y + u_bandStart;
+    highp float t = floor(x / u_pixelsPerTexel);
+    mediump vec4 texel = texture2D(u_texture, vec2(t + 0.5, y + 0.5) /
+u_textureSize);
+    highp float c = x - u_pixelsPerTexel * t;
+    mediump float value = c < 2.0 ? (c < 1.0 ? texel.x : texel.y) :
+(c < 3.0 ? texel.z : texel.w);
+    highp float cell = (y - u_chunkStart) * u_runsPerRow + floor(x / 255.0);
+    highp float row = floor((cell + 0.5) / u_cellsPerRow);
+    highp float column = cell - row * u_cellsPerRow;
+    highp vec2 p = vec2(column * 256.0 + floor(value * 255.0 + 0.5), row);
+    gl_Position = vec4((p + 0.5) / u_histogramSize * 2.0 - 1.0, 0.0, 1.0);
+    gl_PointSize = 1.0;
+}
+---histogramScatterSource
+// added up by blending, a bin counts 255 pixels at most.
+void main(void)
+{
+    gl_FragColor = vec4(1.0 / 255.0);
+}
+---histogramReduceSource
+// the count of bin x over all the cells, in base 256 digits from r to a,
+// added to the counts of the chunks before in u_previous. a chunk counts
+// less than 2^24 pixels, exact in highp floats, and the sum is carried
+// digit by digit.
+uniform sampler2D u_histogram;
+uniform sampler2D u_previous;
+uniform highp vec2 u_histogramSize;
+uniform int u_cellsPerRow;
+uniform int u_rows;
+
+void main(void)
+{
+    highp float bin = floor(gl_FragCoord.x);
+    highp float count = 0.0;
+    int i, j;
+
+    for (j = 0; j < u_rows; ++j) {
+        for (i = 0; i < u_cellsPerRow; ++i) {
+            highp vec2 p = vec2(float(i) * 256.0 + bin, float(j)) + 0.5;
+            count += floor(texture2D(u_histogram, p / u_histogramSize).r *
+255.0 + 0.5);
+        }
+    }
+    highp vec4 digits = floor(texture2D(u_previous,
+vec2((bin + 0.5) / 256.0, 0.5)) * 255.0 + 0.5);
+    highp float carry;
+    digits.x += mod(count, 256.0);
+    count = floor(count / 256.0);
+    carry = floor(digits.x / 256.0);
+    digits.x -= carry * 256.0;
+    digits.y += mod(count, 256.0) + carry;
+    count = floor(count / 256.0);
+    carry = floor(digits.y / 256.0);
+    digits.y -= carry * 256.0;
+    digits.z += mod(count, 256.0) + carry;
+    count = floor(count / 256.0);
+    carry = floor(digits.z / 256.0);
+    digits.z -= carry * 256.0;
+    digits.w += count + carry;
+    gl_FragColor = digits / 255.0;
+}
+---otsuSource
+// the threshold maximizing the variance between the pixels at or below
+// it and those above it, from the reduced histogram.
+uniform sampler2D u_histogram;
+
+highp float countAt(int bin)
+{
+    highp vec4 digits = floor(texture2D(u_histogram,
+vec2((float(bin) + 0.5) / 256.0, 0.5)) * 255.0 + 0.5);
+    return digits.x + 256.0 * (digits.y + 256.0 * (digits.z +
+256.0 * digits.w));
+}
+
+void main(void)
+{
+    highp float total = 0.0;
+    highp float sum = 0.0;
+    int i;
+
+    for (i = 0; i < 256; ++i) {
+        highp float count = countAt(i);
+        total += count;
+        sum += float(i) * count;
+    }
+    highp float below = 0.0;
+    highp float sumBelow = 0.0;
+    highp float best = -1.0;
+    highp float threshold = 0.0;
+    for (i = 0; i < 256; ++i) {
+        highp float count = countAt(i);
+        below += count;
+        sumBelow += float(i) * count;
+        highp float above = total - below;
+        if (below == 0.0 || above == 0.0) {
+            continue;
+        }
+        highp float d = sumBelow / below - (sum - sumBelow) / above;
+        highp float between = below * above * d * d;
+        if (between > best) {
+            best = between;
+            threshold = float(i);
+        }
+    }
+    gl_FragColor = vec4(threshold / 255.0);
+}
+---otsuThresholdSource
+// maxValue where the pixel is above the threshold in u_threshold, every
+// lane of a packed texel on its own.
+uniform sampler2D u_texture;
+uniform sampler2D u_threshold;
+uniform highp vec2 u_textureSize;
+uniform mediump float u_maxValue;
+
+void main(void)
+{
+    mediump float t = texture2D(u_threshold, vec2(0.5)).r;
+    mediump vec4 v = texture2D(u_texture, gl_FragCoord.xy / u_textureSize);
+    mediump vec4 above = vec4(greaterThan(v, vec4(t + 0.5 / 255.0)));
+#ifdef PACKED
+    gl_FragColor = above * u_maxValue;
+#else
+    gl_FragColor = vec4(above.r * u_maxValue);
+#endif
+}
+---connectedStartsSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform sampler2D u_texture;
+out mediump vec4 fragColor;
+
+// red is 1 where a run of pixels whose red channel is nonzero starts in
+// a row, for a summed-area table ranking the runs, green is 1 on the
+// runs.
+void main(void)
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+#ifdef PACKED
+    vec4 orig = texelFetch(u_texture, ivec2(p.x / 4, p.y), 0);
+    float value = orig[p.x % 4];
+    float left = 0.0;
+    if (p.x % 4 > 0) {
+        left = orig[p.x % 4 - 1];
+    } else if (p.x > 0) {
+        left = texelFetch(u_texture, ivec2(p.x / 4 - 1, p.y), 0).a;
+    }
+#else
+    float value = texelFetch(u_texture, p, 0).r;
+    float left = p.x > 0 ? texelFetch(u_texture, p - ivec2(1, 0), 0).r : 0.0;
+#endif
+    float run = value > 0.0 ? 1.0 / 255.0 : 0.0;
+    fragColor = vec4(left > 0.0 ? 0.0 : run, run, 0.0, 0.0);
+}
+---connectedGatherSource
+#version 300 es
+precision highp float;
+precision highp int;
+// entry i compacts the i-th flagged pixel of u_size in raster order, as
+// ranked by the summed-area table of the flags: a run of the rows, or
+// with TABLE a component of the sorted runs.
+uniform highp usampler2D u_table;
+uniform ivec2 u_size;
+uniform int u_listWidth;
+uniform int u_count;
+#ifdef TABLE
+// the components, at two texels each, u_columns to a row.
+uniform highp usampler2D u_runs;
+uniform highp usampler2D u_sums;
+uniform highp usampler2D u_extents;
+uniform int u_columns;
+#else
+// green is 1 on the runs.
+uniform sampler2D u_starts;
+#endif
+out highp uvec4 fragColor;
+
+uint tableAt(int x, int y)
+{
+    return texelFetch(u_table, ivec2(x, y), 0).r;
+}
+
+// the pixel flagged i-th, found by binary search: first its row, where
+// the flags up to the row's end outnumber i, then its column.
+ivec2 flagged(uint i)
+{
+    int lo = 0;
+    int hi = u_size.y - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tableAt(u_size.x, mid + 1) > i) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    int y = lo;
+    uint rest = i - tableAt(u_size.x, y);
+    lo = 0;
+    hi = u_size.x - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tableAt(mid + 1, y + 1) - tableAt(mid + 1, y) > rest) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return ivec2(lo, y);
+}
+
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+#ifdef TABLE
+    int i = t.y * u_columns + t.x / 2;
+    if (i >= u_count) {
+        fragColor = uvec4(0u);
+        return;
+    }
+    // the first run of a component, which holds the totals.
+    ivec2 p = flagged(uint(i));
+    uvec4 run = texelFetch(u_runs, p, 0);
+    uvec4 sums = texelFetch(u_sums, p, 0);
+    uvec4 extents = texelFetch(u_extents, p, 0);
+    if (t.x % 2 == 0) {
+        fragColor = uvec4(extents.y, run.g | extents.z << 16, sums.xy);
+    } else {
+        fragColor = uvec4(sums.z, sums.w, extents.x, run.r);
+    }
+#else
+    int i = t.y * u_listWidth + t.x;
+    if (i >= u_count) {
+        // past the runs, sorted last.
+        fragColor = uvec4(0xffffffffu, 0u, 0u, 0u);
+        return;
+    }
+    ivec2 p = flagged(uint(i));
+    int end = p.x;
+    while (end + 1 < u_size.x &&
+           texelFetch(u_starts, ivec2(end + 1, p.y), 0).g > 0.0) {
+        ++end;
+    }
+    // a label of its own, the row, the first and the last column.
+    fragColor = uvec4(uint(i) + 1u, uint(p.y), uint(p.x), uint(end));
+#endif
+}
+---connectedPropagateSource
+#version 300 es
+precision highp int;
+// label, row, first and last column.
+uniform highp usampler2D u_runs;
+// the ranks of the runs by their starts.
+uniform highp usampler2D u_table;
+uniform ivec2 u_imageSize;
+// the smallest labels hooked onto the runs as depths, see
+// connectedHookVertexSource.
+uniform highp sampler2D u_hooks;
+uniform int u_listWidth;
+uniform int u_count;
+out highp uvec4 fragColor;
+
+uvec4 runAt(uint i)
+{
+    int j = int(i);
+    return texelFetch(u_runs, ivec2(j % u_listWidth, j / u_listWidth), 0);
+}
+
+uint tableAt(int x, int y)
+{
+    return texelFetch(u_table, ivec2(x, y), 0).r;
+}
+
+// the smallest of label and the labels of the runs of row y reaching into
+// columns first to last. those are ranked in a row from the one before
+// the first run starting in the columns up to the last one.
+uint touching(int y, int first, int last, uint label)
+{
+    if (y < 0 || y >= u_imageSize.y) {
+        return label;
+    }
+    first = max(first, 0);
+    last = min(last, u_imageSize.x - 1);
+    uint row = tableAt(u_imageSize.x, y);
+    uint before = tableAt(first, y + 1) - tableAt(first, y);
+    uint end = row + tableAt(last + 1, y + 1) - tableAt(last + 1, y);
+    uint j = row + before;
+    if (before > 0u && int(runAt(j - 1u).a) >= first) {
+        --j;
+    }
+    for (; j < end; ++j) {
+        label = min(label, runAt(j).r);
+    }
+    return label;
+}
+
+// the smallest label of the run, hooked onto it and of the runs touching
+// it above and below, diagonally too with EIGHT. a label names a run of
+// the same component whose own label is no larger, following it skips
+// along the chain. the label is written as a depth too, for the hooks of
+// the next pass.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    uvec4 run = texelFetch(u_runs, t, 0);
+    if (t.y * u_listWidth + t.x >= u_count) {
+        fragColor = run;
+        gl_FragDepth = 1.0;
+        return;
+    }
+    int y = int(run.g);
+#ifdef EIGHT
+    int first = int(run.b) - 1;
+    int last = int(run.a) + 1;
+#else
+    int first = int(run.b);
+    int last = int(run.a);
+#endif
+    uint hook = uint(texelFetch(u_hooks, t, 0).r * 16777216.0);
+    uint label = touching(y - 1, first, last, min(run.r, hook));
+    label = touching(y + 1, first, last, label);
+    label = runAt(runAt(label - 1u).r - 1u).r;
+    fragColor = uvec4(label, run.gba);
+    gl_FragDepth = float(label) / 16777216.0;
+}
+---connectedHookVertexSource
+#version 300 es
+precision highp float;
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform highp usampler2D u_table;
+uniform ivec2 u_imageSize;
+uniform ivec2 u_listSize;
+flat out highp uint v_label;
+
+uvec4 runAt(uint i)
+{
+    int j = int(i);
+    return texelFetch(u_runs, ivec2(j % u_listSize.x, j / u_listSize.x), 0);
+}
+
+uint tableAt(int x, int y)
+{
+    return texelFetch(u_table, ivec2(x, y), 0).r;
+}
+
+uint touching(int y, int first, int last, uint label)
+{
+    if (y < 0 || y >= u_imageSize.y) {
+        return label;
+    }
+    first = max(first, 0);
+    last = min(last, u_imageSize.x - 1);
+    uint row = tableAt(u_imageSize.x, y);
+    uint before = tableAt(first, y + 1) - tableAt(first, y);
+    uint end = row + tableAt(last + 1, y + 1) - tableAt(last + 1, y);
+    uint j = row + before;
+    if (before > 0u && int(runAt(j - 1u).a) >= first) {
+        --j;
+    }
+    for (; j < end; ++j) {
+        label = min(label, runAt(j).r);
+    }
+    return label;
+}
+
+// one point per run, landing on the run its label names when a run
+// touching it has a smaller label. the depth test keeps the smallest one,
+// so whole chains take it at once instead of a run per pass.
+void main(void)
+{
+    uvec4 run = runAt(uint(gl_VertexID));
+    int y = int(run.g);
+#ifdef EIGHT
+    int first = int(run.b) - 1;
+    int last = int(run.a) + 1;
+#else
+    int first = int(run.b);
+    int last = int(run.a);
+#endif
+    uint label = touching(y - 1, first, last, run.r);
+    label = touching(y + 1, first, last, label);
+    gl_PointSize = 1.0;
+    v_label = label;
+    if (label == run.r) {
+        // clipped.
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0);
+        return;
+    }
+    int i = int(run.r) - 1;
+    vec2 p = vec2(ivec2(i % u_listSize.x, i / u_listSize.x)) + 0.5;
+    gl_Position = vec4(p / vec2(u_listSize) * 2.0 - 1.0, 0.0, 1.0);
+}
+---connectedHookSource
+#version 300 es
+precision highp float;
+precision highp int;
+flat in highp uint v_label;
+
+// labels below 2^24 are exact depths.
+void main(void)
+{
+    gl_FragDepth = float(v_label) / 16777216.0;
+}
+---connectedChangedSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform highp usampler2D u_previous;
+out mediump vec4 fragColor;
+
+// only the runs whose label changed pass, for an occlusion query.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    if (texelFetch(u_runs, t, 0).r == texelFetch(u_previous, t, 0).r) {
+        discard;
+    }
+    fragColor = vec4(0.0);
+}
+---connectedSortSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform int u_listWidth;
+// the size of the bitonic sequences being merged.
+uniform int u_block;
+// the distance between the entries compared.
+uniform int u_distance;
+out highp uvec4 fragColor;
+
+uvec4 runAt(int i)
+{
+    return texelFetch(u_runs, ivec2(i % u_listWidth, i / u_listWidth), 0);
+}
+
+// by label, then row, then column. runs of the list are distinct.
+bool before(uvec4 a, uvec4 b)
+{
+    if (a.r != b.r) {
+        return a.r < b.r;
+    }
+    if (a.g != b.g) {
+        return a.g < b.g;
+    }
+    return a.b < b.b;
+}
+
+// one compare and exchange step of a bitonic sort.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    int i = t.y * u_listWidth + t.x;
+    int j = i ^ u_distance;
+    uvec4 run = runAt(i);
+    uvec4 other = runAt(j);
+    bool ascending = (i & u_block) == 0;
+    bool smaller = (i < j) == ascending;
+    fragColor = before(other, run) == smaller ? other : run;
+}
+---connectedStatsSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform int u_listWidth;
+// area and sums of columns and rows, 64 bits each, low word first.
+layout(location = 0) out highp uvec4 sums;
+// the high word of the row sum, the first column in the low 16 bits and
+// the last one in the high bits, the last row.
+layout(location = 1) out highp uvec4 extents;
+
+// the statistics of a single run.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    uvec4 run = texelFetch(u_runs, t, 0);
+    uint pixels = run.a - run.b + 1u;
+    sums = uvec4(pixels, (run.b + run.a) * pixels / 2u, 0u, run.g * pixels);
+    extents = uvec4(0u, run.b | run.a << 16, run.g, 0u);
+}
+---connectedReduceSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform highp usampler2D u_sums;
+uniform highp usampler2D u_extents;
+uniform int u_listWidth;
+uniform int u_count;
+uniform int u_step;
+layout(location = 0) out highp uvec4 sums;
+layout(location = 1) out highp uvec4 extents;
+
+// the statistics of the runs from an entry on add those u_step entries
+// further of the same label, after log2 n passes the first run of a
+// label holds those of the label.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    sums = texelFetch(u_sums, t, 0);
+    extents = texelFetch(u_extents, t, 0);
+    int j = t.y * u_listWidth + t.x + u_step;
+    ivec2 q = ivec2(j % u_listWidth, j / u_listWidth);
+    if (j >= u_count ||
+        texelFetch(u_runs, q, 0).r != texelFetch(u_runs, t, 0).r) {
+        return;
+    }
+    uvec4 s = texelFetch(u_sums, q, 0);
+    uvec4 e = texelFetch(u_extents, q, 0);
+    uint low = sums.y + s.y;
+    sums.z += s.z + (low < s.y ? 1u : 0u);
+    sums.y = low;
+    low = sums.w + s.w;
+    extents.x += e.x + (low < s.w ? 1u : 0u);
+    sums.w = low;
+    sums.x += s.x;
+    uint first = min(extents.y & 0xffffu, e.y & 0xffffu);
+    uint last = max(extents.y >> 16, e.y >> 16);
+    extents.y = first | last << 16;
+    extents.z = max(extents.z, e.z);
+}
+---connectedHeadsSource
+#version 300 es
+precision highp int;
+uniform highp usampler2D u_runs;
+uniform int u_listWidth;
+uniform int u_count;
+out mediump vec4 fragColor;
+
+// 1 on the first run of each label, for a summed-area table ranking the
+// components.
+void main(void)
+{
+    ivec2 t = ivec2(gl_FragCoord.xy);
+    int i = t.y * u_listWidth + t.x;
+    bool head = i < u_count;
+    if (head && i > 0) {
+        ivec2 p = ivec2((i - 1) % u_listWidth, (i - 1) / u_listWidth);
+        head = texelFetch(u_runs, p, 0).r != texelFetch(u_runs, t, 0).r;
+    }
+    fragColor = vec4(head ? 1.0 / 255.0 : 0.0);
+}
 ---vertexShaderSource
 attribute vec4 v_position;
 void main()
 {
    gl_Position = v_position;
 }
+---vertexShader300Source
+#version 300 es
+layout(location = 0) in vec4 v_position;
+void main()
+{
+   gl_Position = v_position;
+}
@@ -14,6 +14,9 @@ gaussianLoadImageFromFile(const char* file)
 {
   std::unique_ptr<nv::Image> image(new nv::Image());
 
+  // the processors only read the red channel, decode straight to luma
+  // (ITU-R BT.601) and upload a byte per pixel.
+  image->setDecodeToLuminance(true, 0.299f, 0.587f);
   if (!image->loadImageFromFile(file)) {
     return NULL;
   }
@@ -210,6 +213,12 @@ main(int argc, char** argv)
     wf.registerIImageProcessor(erode2time.get());
     wf.registerIImageProcessor(erode10time.get());
     wf.registerIImageProcessor(dilate10time.get());
+    wf.enablePipelineOptimization(&pm);
+    wf.enablePassFusion(&pm);
+    if (!wf.setOutputFormat(OUTPUT_GRAY, &pm)) {
+      LOGE(LOG_TAG, "fails to create gray output packer.\n");
+      return false;
+    }
 
     struct timespec t1, t2;
     clock_gettime(CLOCK_MONOTONIC, &t1);
@@ -217,21 +226,21 @@ main(int argc, char** argv)
     ImageDesc desc = { image->getWidth(), image->getHeight(),
                        image->getFormat(), image->getLevel(0) };
     ImageOutput imo = wf.process(desc);
-    std::unique_ptr<uint8_t[]> readback(std::move(imo.outputBytes));
-    std::unique_ptr<uint8_t[]> processed(new uint8_t[desc.width * desc.height]);
-    const uint8_t* rbp = readback.get();
-    uint8_t* procp = processed.get();
-    for (int i = 0; i < desc.width * desc.height; ++i, ++procp, rbp += 4) {
-      *procp = *rbp;
-    }
+    std::unique_ptr<uint8_t[]> processed(std::move(imo.outputBytes));
     clock_gettime(CLOCK_MONOTONIC, &t2);
+    if (!processed) {
+      printf("fails to process the image.\n");
+      return 1;
+    }
 
     int rowBytes = (desc.width * 24 + 31) / 32 * 4;
     std::unique_ptr<uint8_t[]> saveBits(new uint8_t[rowBytes * desc.height]);
     uint8_t* savep = saveBits.get();
-    procp = processed.get();
-    for (int y = 0; y < desc.height; ++y, savep += rowBytes) {
+    const uint8_t* procrow = processed.get();
+    for (int y = 0; y < desc.height;
+         ++y, savep += rowBytes, procrow += imo.stride) {
       uint8_t* rowp = savep;
+      const uint8_t* procp = procrow;
       for (int x = 0; x < desc.width; ++x, ++procp, rowp += 3) {
         rowp[0] = *procp;
         rowp[1] = *procp;
@@ -87,6 +87,12 @@ namespace nv {
         //initialize an image from a file
         NVSDKENTRY bool loadImageFromFile( const char* file);
 
+        //have color png files decoded straight to 8 bit luminance (GL_LUMINANCE),
+        //gray = red * r + green * g + (1 - red - green) * b, alpha dropped.
+        //negative weights select the libpng defaults (ITU-R BT.709). must be set
+        //before loadImageFromFile
+        NVSDKENTRY void setDecodeToLuminance( bool enable, float red = -1.0f, float green = -1.0f);
+
         //convert a suitable image from a cubemap cross to a cubemap (returns false for unsuitable images)
         NVSDKENTRY bool convertCrossToCubemap();
 
@@ -107,6 +113,11 @@ namespace nv {
         GLenum _type;
         int _elementSize;
 
+        //luminance decoding, see setDecodeToLuminance
+        bool _toLuminance;
+        float _redWeight;
+        float _greenWeight;
+
         //pointers to the levels
         std::vector<GLubyte*> _data;
 
@@ -37,7 +37,8 @@ Image::FormatInfo Image::formatTable[] = {
 //
 ////////////////////////////////////////////////////////////
 Image::Image() : _width(0), _height(0), _depth(0), _levelCount(0), _faces(0), _format(GL_RGBA),
-    _internalFormat(GL_RGBA), _type(GL_UNSIGNED_BYTE), _elementSize(0) {
+    _internalFormat(GL_RGBA), _type(GL_UNSIGNED_BYTE), _elementSize(0), _toLuminance(false),
+    _redWeight(-1.0f), _greenWeight(-1.0f) {
 }
 
 //
@@ -128,6 +129,15 @@ bool Image::loadImageFromFile( const char* file) {
     return false;
 }
 
+//
+//
+////////////////////////////////////////////////////////////
+void Image::setDecodeToLuminance( bool enable, float red, float green) {
+    _toLuminance = enable;
+    _redWeight = red;
+    _greenWeight = green;
+}
+
 //
 //
 ////////////////////////////////////////////////////////////
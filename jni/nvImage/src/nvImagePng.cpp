@@ -127,9 +127,19 @@ bool Image::readPng( const char *file, Image& i) {
     if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) {
         //png_set_gray_1_2_4_to_8(png_ptr);
     }
-    if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+    if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) && !i._toLuminance) {
         png_set_tRNS_to_alpha(png_ptr);
     }
+    // let libpng weight the channels into one while decoding, a third to a
+    // quarter of the bytes of the color image are ever stored
+    if (i._toLuminance) {
+        if (colorType & PNG_COLOR_MASK_COLOR) {
+            png_set_rgb_to_gray(png_ptr, 1, i._redWeight, i._greenWeight);
+        }
+        if (colorType & PNG_COLOR_MASK_ALPHA) {
+            png_set_strip_alpha(png_ptr);
+        }
+    }
 
     // now configure for reading, and allocate the memory
     png_read_update_info(png_ptr, info_ptr);